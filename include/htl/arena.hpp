@@ -1,45 +1,65 @@
 #ifndef HTL_ARENA_H
 #define HTL_ARENA_H
 
+#include <new>
+#include <utility>
+
 #include "details/base_arena.hpp"
 
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 namespace htl {
 
+// Controls how an arena obtains its backing memory. With the default options
+// the block comes from the heap. Otherwise, on Linux, the block is mapped
+// directly with mmap. Huge pages and NUMA binding are treated as hints: if
+// the system refuses them, the arena silently uses normal pages. On other
+// systems all options are ignored.
+struct arena_options {
+  bool huge_pages = false;              // Request explicit huge pages
+  bool transparent_huge_pages = false;  // Advise the kernel to use THP
+  int numa_node = -1;                   // Bind the memory to this node if >= 0
+  bool prefault = false;  // Touch every page when the arena is built
+};
+
 class arena : public details::base_arena {
  public:
-  arena(std::size_t capacity = 0) {
+  arena(std::size_t capacity = 0) : mapped_size_(0) {
     if (capacity > 0) {
-      data_ = new std::byte[capacity];
-      offset_ = data_;
-      prev_offset_ = offset_;
-      end_ = data_ + capacity;
+      this->set_block(new std::byte[capacity], capacity);
     }
   }
 
-  arena(arena&& other) {
-    this->data_ = other.data_;
-    this->offset_ = other.offset_;
-    this->prev_offset_ = other.prev_offset_;
-    this->end_ = other.end_;
+  arena(std::size_t capacity, const arena_options& options)
+      : mapped_size_(0) {
+    if (capacity > 0) {
+#ifdef __linux__
+      if (options.huge_pages || options.transparent_huge_pages ||
+          options.numa_node >= 0 || options.prefault) {
+        this->set_block(map(capacity, options), capacity);
+      } else {
+        this->set_block(new std::byte[capacity], capacity);
+      }
+#else
+      (void)options;
+      this->set_block(new std::byte[capacity], capacity);
+#endif
+    }
+  }
 
-    other.data_ = nullptr;
-    other.offset_ = nullptr;
-    other.prev_offset_ = nullptr;
-    other.end_ = nullptr;
+  arena(arena&& other)
+      : mapped_size_(std::exchange(other.mapped_size_, 0)) {
+    this->move_from(other);
   }
 
   arena& operator=(arena&& other) {
     this->deallocate();
-
-    this->data_ = other.data_;
-    this->offset_ = other.offset_;
-    this->prev_offset_ = other.prev_offset_;
-    this->end_ = other.end_;
-
-    other.data_ = nullptr;
-    other.offset_ = nullptr;
-    other.prev_offset_ = nullptr;
-    other.end_ = nullptr;
+    this->move_from(other);
+    mapped_size_ = std::exchange(other.mapped_size_, 0);
 
     return *this;
   }
@@ -52,15 +72,85 @@ class arena : public details::base_arena {
   arena& operator=(const arena& other) = delete;
 
  private:
+  std::size_t mapped_size_;  // Size of the mapping, or 0 if on the heap
+
   void deallocate() {
     if (data_) {
+      this->release_block();
+#ifdef __linux__
+      if (mapped_size_ > 0) {
+        munmap(data_, mapped_size_);
+        mapped_size_ = 0;
+      } else {
+        delete[] data_;
+      }
+#else
       delete[] data_;
+#endif
       data_ = nullptr;
       offset_ = nullptr;
       prev_offset_ = nullptr;
       end_ = nullptr;
     }
   }
+
+#ifdef __linux__
+  std::byte* map(std::size_t capacity, const arena_options& options) {
+    constexpr std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    const std::size_t page_size =
+        static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    void* ptr = MAP_FAILED;
+
+    if (options.huge_pages) {
+      mapped_size_ = round_up(capacity, HUGE_PAGE_SIZE);
+      ptr = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE,
+                 flags | MAP_HUGETLB, -1, 0);
+    }
+
+    if (ptr == MAP_FAILED) {
+      mapped_size_ = round_up(capacity, page_size);
+      ptr = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+      if (ptr == MAP_FAILED) {
+        mapped_size_ = 0;
+        throw std::bad_alloc();
+      }
+
+      if (options.huge_pages || options.transparent_huge_pages) {
+        madvise(ptr, mapped_size_, MADV_HUGEPAGE);
+      }
+    }
+
+    // The policy must be set before any page is touched, as pages are placed
+    // on first touch. MPOL_BIND is used directly to avoid depending on
+    // libnuma.
+    if (options.numa_node >= 0) {
+      constexpr int MPOL_BIND_MODE = 2;
+      constexpr std::size_t BITS = 8 * sizeof(unsigned long);
+      constexpr std::size_t MAX_NODES = 1024;
+      const std::size_t node = static_cast<std::size_t>(options.numa_node);
+
+      if (node < MAX_NODES) {
+        unsigned long mask[MAX_NODES / BITS] = {};
+        mask[node / BITS] = 1UL << (node % BITS);
+        syscall(SYS_mbind, ptr, mapped_size_, MPOL_BIND_MODE, mask,
+                MAX_NODES + 1, 0);
+      }
+    }
+
+    if (options.prefault) {
+      volatile unsigned char* bytes = static_cast<unsigned char*>(ptr);
+      for (std::size_t i = 0; i < mapped_size_; i += page_size) bytes[i] = 0;
+    }
+
+    return static_cast<std::byte*>(ptr);
+  }
+
+  static std::size_t round_up(std::size_t size, std::size_t multiple) {
+    return (size + multiple - 1) / multiple * multiple;
+  }
+#endif
 };
 
 }  // namespace htl
@@ -0,0 +1,94 @@
+#ifndef HTL_ARENA_ALLOCATOR_H
+#define HTL_ARENA_ALLOCATOR_H
+
+#include <cstddef>
+#include <limits>
+#include <memory_resource>
+#include <new>
+
+#include "details/base_arena.hpp"
+
+namespace htl {
+
+// Exposes an htl::arena or htl::static_arena as a std::pmr::memory_resource,
+// so that std::pmr containers may draw their memory from it. Deallocation is
+// a no-op; memory is only reclaimed when the arena is cleared. The arena must
+// outlive the resource, and every container using it.
+class arena_resource : public std::pmr::memory_resource {
+ public:
+  arena_resource(details::base_arena& arena) : arena_(&arena) {}
+
+  [[nodiscard]] details::base_arena& arena() const noexcept { return *arena_; }
+
+ private:
+  details::base_arena* arena_;
+
+  void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+    void* out = arena_->malloc(bytes > 0 ? bytes : 1, alignment);
+
+    if (out == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    return out;
+  }
+
+  void do_deallocate(void*, std::size_t, std::size_t) override {}
+
+  bool do_is_equal(
+      const std::pmr::memory_resource& other) const noexcept override {
+    const arena_resource* other_resource =
+        dynamic_cast<const arena_resource*>(&other);
+    return other_resource != nullptr && other_resource->arena_ == arena_;
+  }
+};
+
+// A typed allocator which satisfies the standard Allocator requirements, and
+// draws its memory from an arena. As with arena_resource, deallocate does
+// nothing, and the arena must outlive every container using the allocator.
+template <typename T>
+class arena_allocator {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+
+  arena_allocator(details::base_arena& arena) noexcept : arena_(&arena) {}
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U>& other) noexcept
+      : arena_(other.arena_) {}
+
+  [[nodiscard]] T* allocate(size_type n) {
+    if (n > std::numeric_limits<size_type>::max() / sizeof(T)) {
+      throw std::bad_array_new_length();
+    }
+
+    void* out = arena_->malloc(n > 0 ? n * sizeof(T) : 1, alignof(T));
+
+    if (out == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    return reinterpret_cast<T*>(out);
+  }
+
+  void deallocate(T*, size_type) noexcept {}
+
+  [[nodiscard]] details::base_arena& arena() const noexcept { return *arena_; }
+
+  template <typename U>
+  [[nodiscard]] bool operator==(const arena_allocator<U>& other) const noexcept {
+    return arena_ == other.arena_;
+  }
+
+ private:
+  template <typename U>
+  friend class arena_allocator;
+
+  details::base_arena* arena_;
+};
+
+}  // namespace htl
+
+#endif
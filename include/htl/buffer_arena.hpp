@@ -0,0 +1,45 @@
+#ifndef HTL_BUFFER_ARENA_H
+#define HTL_BUFFER_ARENA_H
+
+#include <span>
+
+#include "details/base_arena.hpp"
+
+namespace htl {
+
+// An arena over memory owned by someone else, such as an array on the stack
+// or a shared memory segment. The buffer must outlive the arena. If an
+// upstream arena is given, allocations which do not fit in the buffer are
+// taken from it instead. Such allocations are only reclaimed when the
+// upstream arena is cleared, so the upstream arena must not be cleared or
+// destroyed while the buffer_arena is still in use.
+class buffer_arena : public details::base_arena {
+ public:
+  buffer_arena(std::span<std::byte> buffer,
+               details::base_arena* upstream = nullptr) {
+    if (buffer.size() > 0) {
+      this->set_block(buffer.data(), buffer.size());
+    }
+
+    upstream_ = upstream;
+  }
+
+  buffer_arena(buffer_arena&& other) { this->move_from(other); }
+
+  buffer_arena& operator=(buffer_arena&& other) {
+    this->release_block();
+    this->move_from(other);
+
+    return *this;
+  }
+
+  ~buffer_arena() { this->release_block(); }
+
+  // Two arenas handing out the same memory would overwrite each other.
+  buffer_arena(const buffer_arena& other) = delete;
+  buffer_arena& operator=(const buffer_arena& other) = delete;
+};
+
+}  // namespace htl
+
+#endif
@@ -0,0 +1,185 @@
+#ifndef HTL_CONCURRENT_ARENA_H
+#define HTL_CONCURRENT_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <utility>
+
+namespace htl {
+
+// An arena which may be shared by many threads. Allocations are claimed with
+// a single atomic fetch-add on the offset, so malloc is lock-free. Like the
+// other arenas, nothing is ever freed individually; the whole block is reset
+// with clear, which must not race with any allocation.
+class concurrent_arena {
+ public:
+  class cache;
+
+  concurrent_arena(std::size_t capacity = 0)
+      : data_(nullptr), offset_(0), capacity_(0) {
+    if (capacity > 0) {
+      data_ = new std::byte[capacity];
+      capacity_ = capacity;
+    }
+  }
+
+  ~concurrent_arena() { delete[] data_; }
+
+  // Threads hold references to a shared arena, so it may not be copied or
+  // moved out from under them.
+  concurrent_arena(const concurrent_arena& other) = delete;
+  concurrent_arena& operator=(const concurrent_arena& other) = delete;
+  concurrent_arena(concurrent_arena&& other) = delete;
+  concurrent_arena& operator=(concurrent_arena&& other) = delete;
+
+  void* malloc(std::size_t size) {
+    if (size > capacity_ || size == 0) {
+      return nullptr;
+    }
+
+    // Every request is padded to a multiple of the maximum alignment. As the
+    // block itself is suitably aligned, every offset handed out is as well,
+    // and the claim can be done without a compare-exchange loop.
+    const std::size_t padded = pad(size);
+    const std::size_t start =
+        offset_.fetch_add(padded, std::memory_order_relaxed);
+
+    // The offset is allowed to run past the end of the block. Once this
+    // happens the arena is considered full.
+    if (start + padded > capacity_) {
+      return nullptr;
+    }
+
+    return reinterpret_cast<void*>(data_ + start);
+  }
+
+  template <typename T, typename... Types>
+  T* make(Types&&... args) {
+    // Allocations are only aligned to std::max_align_t
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "htl::concurrent_arena: T is over-aligned");
+    T* out = reinterpret_cast<T*>(malloc(sizeof(T)));
+
+    if (out == nullptr) {
+      return nullptr;
+    }
+
+    new (out) T(std::forward<Types>(args)...);
+
+    return out;
+  }
+
+  std::byte* data() { return data_; }
+
+  const std::byte* data() const { return data_; }
+
+  std::size_t capacity() const { return capacity_; }
+
+  std::size_t remaining() const {
+    const std::size_t offset = offset_.load(std::memory_order_relaxed);
+    return offset < capacity_ ? capacity_ - offset : 0;
+  }
+
+  // Not thread safe ! No other thread may allocate while the arena is being
+  // cleared, and all caches must be reset afterwards.
+  void clear() {
+    const std::size_t offset = offset_.load(std::memory_order_relaxed);
+    const std::size_t used = offset < capacity_ ? offset : capacity_;
+
+    if (used > 0) std::memset(data_, 0, used);
+
+    offset_.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr std::size_t MAX_ALIGN = alignof(std::max_align_t);
+
+  std::byte* data_;                  // Beginning of allocation
+  std::atomic<std::size_t> offset_;  // Offset of unused memory
+  std::size_t capacity_;             // Size of the allocation
+
+  static std::size_t pad(std::size_t size) {
+    return (size + MAX_ALIGN - 1) / MAX_ALIGN * MAX_ALIGN;
+  }
+};
+
+// A per-thread front end for a concurrent_arena. Chunks of chunk_size bytes
+// are claimed from the shared arena, and small allocations are then bumped
+// out of the current chunk without touching the shared atomic. Any unused
+// tail of a chunk is left behind when a new chunk is claimed. Allocations
+// larger than a chunk go directly to the shared arena.
+class concurrent_arena::cache {
+ public:
+  cache(concurrent_arena& arena, std::size_t chunk_size)
+      : arena_(&arena),
+        offset_(nullptr),
+        end_(nullptr),
+        chunk_size_(concurrent_arena::pad(chunk_size)) {}
+
+  // A cache must only ever be used by a single thread.
+  cache(const cache& other) = delete;
+  cache& operator=(const cache& other) = delete;
+
+  void* malloc(std::size_t size) {
+    if (size == 0) {
+      return nullptr;
+    }
+
+    const std::size_t padded = concurrent_arena::pad(size);
+
+    if (padded > static_cast<std::size_t>(end_ - offset_)) {
+      if (padded >= chunk_size_) {
+        return arena_->malloc(size);
+      }
+
+      std::byte* chunk =
+          reinterpret_cast<std::byte*>(arena_->malloc(chunk_size_));
+      if (chunk == nullptr) {
+        return nullptr;
+      }
+
+      offset_ = chunk;
+      end_ = chunk + chunk_size_;
+    }
+
+    void* out = reinterpret_cast<void*>(offset_);
+    offset_ += padded;
+
+    return out;
+  }
+
+  template <typename T, typename... Types>
+  T* make(Types&&... args) {
+    // Allocations are only aligned to std::max_align_t
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "htl::concurrent_arena: T is over-aligned");
+    T* out = reinterpret_cast<T*>(malloc(sizeof(T)));
+
+    if (out == nullptr) {
+      return nullptr;
+    }
+
+    new (out) T(std::forward<Types>(args)...);
+
+    return out;
+  }
+
+  // Forget the current chunk. This must be called after the shared arena has
+  // been cleared.
+  void reset() {
+    offset_ = nullptr;
+    end_ = nullptr;
+  }
+
+ private:
+  concurrent_arena* arena_;
+  std::byte* offset_;  // Beginning of unused memory in the current chunk
+  std::byte* end_;     // End of the current chunk
+  std::size_t chunk_size_;
+};
+
+}  // namespace htl
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef HTL_DETAILS_ARENA_DEBUG_H
+#define HTL_DETAILS_ARENA_DEBUG_H
+
+#include <cstddef>
+#include <cstring>
+
+// Defining HTL_ARENA_DEBUG places a red zone after every arena allocation,
+// and fills fresh and released memory with recognizable patterns. If the
+// program is also built with AddressSanitizer, unused memory, released memory
+// and red zones are poisoned, so that any access to them is reported. Without
+// HTL_ARENA_DEBUG all of this compiles away.
+#if defined(HTL_ARENA_DEBUG)
+#if defined(__SANITIZE_ADDRESS__)
+#define HTL_ARENA_ASAN
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define HTL_ARENA_ASAN
+#endif
+#endif
+#endif
+
+#ifdef HTL_ARENA_ASAN
+#include <sanitizer/asan_interface.h>
+#endif
+
+namespace htl {
+namespace details {
+
+#ifdef HTL_ARENA_DEBUG
+constexpr std::size_t ARENA_RED_ZONE = 32;
+constexpr unsigned char ARENA_ALLOC_PATTERN = 0xCD;
+constexpr unsigned char ARENA_FREED_PATTERN = 0xDD;
+#else
+constexpr std::size_t ARENA_RED_ZONE = 0;
+#endif
+
+inline void arena_poison([[maybe_unused]] const std::byte* p,
+                         [[maybe_unused]] std::size_t n) {
+#ifdef HTL_ARENA_ASAN
+  ASAN_POISON_MEMORY_REGION(p, n);
+#endif
+}
+
+inline void arena_unpoison([[maybe_unused]] const std::byte* p,
+                           [[maybe_unused]] std::size_t n) {
+#ifdef HTL_ARENA_ASAN
+  ASAN_UNPOISON_MEMORY_REGION(p, n);
+#endif
+}
+
+// Prepares memory which is being handed out by an arena.
+inline void arena_claim(std::byte* p, std::size_t n) {
+  arena_unpoison(p, n);
+#ifdef HTL_ARENA_DEBUG
+  std::memset(p, ARENA_ALLOC_PATTERN, n);
+#endif
+}
+
+// Wipes memory which is being returned to an arena. In debug mode it is
+// filled with a pattern and poisoned, otherwise it is zeroed.
+inline void arena_wipe(std::byte* p, std::size_t n) {
+  if (n == 0) return;
+  arena_unpoison(p, n);
+#ifdef HTL_ARENA_DEBUG
+  std::memset(p, ARENA_FREED_PATTERN, n);
+#else
+  std::memset(p, 0, n);
+#endif
+  arena_poison(p, n);
+}
+
+// Number of leading bytes of [p, p + n) which may be read.
+inline std::size_t arena_readable(const std::byte* p, std::size_t n) {
+#ifdef HTL_ARENA_ASAN
+  const void* poisoned =
+      __asan_region_is_poisoned(const_cast<std::byte*>(p), n);
+  if (poisoned != nullptr) {
+    return static_cast<std::size_t>(static_cast<const std::byte*>(poisoned) -
+                                    p);
+  }
+#endif
+  (void)p;
+  return n;
+}
+
+}  // namespace details
+}  // namespace htl
+
+#endif
@@ -2,50 +2,239 @@
 #define HTL_DETAILS_BASE_ARENA_H
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "arena_debug.hpp"
 
 namespace htl {
+
+// Usage statistics of an arena. These are only recorded when HTL_ARENA_STATS
+// is defined before including any arena header; otherwise all fields are
+// always zero.
+struct arena_stats {
+  std::size_t allocations = 0;         // Successful allocations
+  std::size_t failed_allocations = 0;  // Allocations which returned nullptr
+  std::size_t bytes_requested = 0;     // Sum of all requested sizes
+  std::size_t bytes_consumed = 0;      // Requested bytes plus alignment waste
+  std::size_t high_water_mark = 0;     // Most bytes in use, across clears
+};
+
 namespace details {
 
 class base_arena {
+  struct finalizer;
+
  public:
+  // Records the state of an arena, so that it may later be rewound to it.
+  class marker {
+   private:
+    friend class base_arena;
+
+    std::byte* offset_;
+    finalizer* finalizers_;
+
+    marker(std::byte* offset, finalizer* finalizers)
+        : offset_(offset), finalizers_(finalizers) {}
+  };
+
   void* malloc(std::size_t size) {
-    if (size > remaining() || size == 0) {
+    // Ensure that the returned address will be suitably aligned for any type.
+    return malloc(size, alignof(std::max_align_t));
+  }
+
+  // Alignment must be a power of two. If the arena is full and has an
+  // upstream arena, the request is passed on to it.
+  void* malloc(std::size_t size, std::size_t alignment) {
+    if (size == 0) {
+      record_failure();
       return nullptr;
     }
 
-    // Ensure that the returned address will be suitably aligned for any type.
-    constexpr std::size_t MAX_ALIGN = alignof(std::max_align_t);
-    const std::size_t modulo =
-        reinterpret_cast<std::size_t>(offset_) % MAX_ALIGN;
-    if (modulo > 0) {
-      if ((size + MAX_ALIGN - modulo) > remaining()) {
-        return nullptr;
-      }
+    if (size > remaining()) {
+      return overflow(size, alignment);
+    }
 
-      offset_ += MAX_ALIGN - modulo;
+    // In debug builds, a red zone is also left after each allocation.
+    const std::size_t modulo =
+        reinterpret_cast<std::size_t>(offset_) % alignment;
+    const std::size_t padding = modulo > 0 ? alignment - modulo : 0;
+    if ((size + padding + ARENA_RED_ZONE) > remaining()) {
+      return overflow(size, alignment);
     }
 
+    offset_ += padding;
+
     void* out = reinterpret_cast<void*>(offset_);
+    arena_claim(offset_, size);
 
     prev_offset_ = offset_;
-    offset_ += size;
+    offset_ += size + ARENA_RED_ZONE;
+
+    record_allocation(size, size + padding + ARENA_RED_ZONE);
 
     return out;
   }
 
+  // Grows or shrinks the allocation at ptr in place, which is only possible
+  // when it is the most recent allocation in the arena. Returns false, and
+  // leaves the arena untouched, if this is not the case or if there is not
+  // enough room to grow.
+  bool try_extend(void* ptr, std::size_t new_size) {
+    std::byte* p = reinterpret_cast<std::byte*>(ptr);
+
+    if (upstream_ && p != nullptr && !owns(p)) {
+      return upstream_->try_extend(ptr, new_size);
+    }
+
+    if (p == nullptr || p != prev_offset_ || offset_ < p + ARENA_RED_ZONE ||
+        new_size == 0 ||
+        new_size + ARENA_RED_ZONE > static_cast<std::size_t>(end_ - p)) {
+      return false;
+    }
+
+    std::byte* old_end = offset_ - ARENA_RED_ZONE;
+    std::byte* new_end = p + new_size;
+    if (new_end > old_end) {
+      arena_claim(old_end, static_cast<std::size_t>(new_end - old_end));
+      record_growth(static_cast<std::size_t>(new_end - old_end));
+    } else {
+      arena_wipe(new_end, static_cast<std::size_t>(old_end - new_end));
+    }
+
+    offset_ = new_end + ARENA_RED_ZONE;
+
+    return true;
+  }
+
+  // Resizes the allocation at ptr, in place if possible. Otherwise a new
+  // block is allocated, and the old contents are copied into it. As the arena
+  // does not record the size of each allocation, all bytes from ptr up to the
+  // end of the used memory are copied, up to a maximum of new_size. The old
+  // block is not reclaimed until the arena is cleared or rewound.
+  void* realloc(void* ptr, std::size_t new_size) {
+    if (ptr == nullptr) {
+      return malloc(new_size);
+    }
+
+    if (upstream_ && !owns(ptr)) {
+      return upstream_->realloc(ptr, new_size);
+    }
+
+    if (try_extend(ptr, new_size)) {
+      return ptr;
+    }
+
+    const std::byte* p = reinterpret_cast<const std::byte*>(ptr);
+    std::size_t n_copy = static_cast<std::size_t>(offset_ - p);
+    if (n_copy > new_size) n_copy = new_size;
+    n_copy = arena_readable(p, n_copy);
+
+    void* out = malloc(new_size);
+
+    if (out != nullptr) {
+      std::memcpy(out, ptr, n_copy);
+    }
+
+    return out;
+  }
+
+  // Constructs a new T in the arena. If T is not trivially destructible, a
+  // finalizer is also recorded in the arena, so that the destructor of the
+  // object is called when the arena is cleared, rewound past the object, or
+  // destroyed. Finalizers are run in the reverse order of construction.
   template <typename T, typename... Types>
-  T* make(Types... args) {
-    T* out = reinterpret_cast<T*>(malloc(sizeof(T)));
+  T* make(Types&&... args) {
+    finalizer* fin = nullptr;
+    std::byte* const offset = offset_;
+    std::byte* const prev_offset = prev_offset_;
+
+    if constexpr (std::is_trivially_destructible_v<T> == false) {
+      fin = make_finalizer();
+
+      if (fin == nullptr) {
+        return nullptr;
+      }
+    }
+
+    T* out = reinterpret_cast<T*>(malloc(sizeof(T), alignof(T)));
 
     if (out == nullptr) {
+      undo(offset, prev_offset);
       return nullptr;
     }
 
-    new (out) T(args...);
+    new (out) T(std::forward<Types>(args)...);
+
+    if constexpr (std::is_trivially_destructible_v<T> == false) {
+      push_finalizer<T>(fin, out, 1);
+    }
 
     return out;
   }
 
+  // Constructs an array of n value initialized objects of type T in the
+  // arena. Destructors are handled as they are for make. An empty span is
+  // returned if the arena does not have enough room.
+  template <typename T>
+  std::span<T> make_array(std::size_t n) {
+    finalizer* fin = nullptr;
+    std::byte* const offset = offset_;
+    std::byte* const prev_offset = prev_offset_;
+
+    if constexpr (std::is_trivially_destructible_v<T> == false) {
+      fin = make_finalizer();
+
+      if (fin == nullptr) {
+        return {};
+      }
+    }
+
+    T* out = allocate_array<T>(n);
+
+    if (out == nullptr) {
+      undo(offset, prev_offset);
+      return {};
+    }
+
+    std::size_t i = 0;
+    try {
+      for (; i < n; i++) new (out + i) T();
+    } catch (...) {
+      while (i > 0) out[--i].~T();
+      throw;
+    }
+
+    if constexpr (std::is_trivially_destructible_v<T> == false) {
+      push_finalizer<T>(fin, out, n);
+    }
+
+    return std::span<T>(out, n);
+  }
+
+  // Allocates room for an array of n objects of type T, without initializing
+  // any of them.
+  template <typename T>
+  std::span<T> make_array_uninit(std::size_t n) {
+    static_assert(std::is_trivially_default_constructible_v<T> &&
+                      std::is_trivially_destructible_v<T>,
+                  "htl::arena::make_array_uninit requires a trivial type");
+
+    T* out = allocate_array<T>(n);
+
+    if (out == nullptr) {
+      return {};
+    }
+
+    return std::span<T>(out, n);
+  }
+
+  // Objects built with make are destroyed by the arena. This is only needed
+  // for objects which are constructed by hand in memory obtained from malloc.
   template <typename T>
   auto dtor() {
     return [](T* ptr) { ptr->~T(); };
@@ -59,26 +248,210 @@ class base_arena {
     return static_cast<std::size_t>(end_ - offset_);
   }
 
+  // Returns a snapshot of the usage statistics. See arena_stats.
+  [[nodiscard]] arena_stats stats() const {
+#ifdef HTL_ARENA_STATS
+    return stats_;
+#else
+    return arena_stats();
+#endif
+  }
+
+  void reset_stats() {
+#ifdef HTL_ARENA_STATS
+    stats_ = arena_stats();
+#endif
+  }
+
+  [[nodiscard]] marker mark() const { return marker(offset_, finalizers_); }
+
+  // Releases everything allocated since the marker was taken. Any objects
+  // made since then are destroyed, and the released memory is zeroed.
+  void rewind(marker m) {
+    finalize(m.finalizers_);
+
+    if (offset_ > m.offset_) {
+      arena_wipe(m.offset_, static_cast<std::size_t>(offset_ - m.offset_));
+    }
+
+    // A pointer handed out before the rewind may equal the new offset, so
+    // nothing may be extended until the next allocation
+    offset_ = m.offset_;
+    prev_offset_ = nullptr;
+  }
+
   void clear() {
-    unsigned char* data = reinterpret_cast<unsigned char*>(data_);
+    finalize(nullptr);
 
-    for (std::size_t i = 0; i < capacity(); i++) data[i] = 0;
+    if (data_) arena_wipe(data_, capacity());
 
     offset_ = data_;
-    prev_offset_ = data_;
+    prev_offset_ = nullptr;
   }
 
  protected:
   std::byte* data_;         // Beginning of allocation
   std::byte* offset_;       // Beginning of unused memory
-  std::byte* prev_offset_;  // Previous offset
+  std::byte* prev_offset_;  // Last allocation, null after a reset
   std::byte* end_;          // End of the allocation
+  finalizer* finalizers_;   // Most recent object needing destruction
+  base_arena* upstream_;    // Used once this arena is full, if not null
+#ifdef HTL_ARENA_STATS
+  arena_stats stats_;
+#endif
 
   base_arena()
       : data_(nullptr),
         offset_(nullptr),
         prev_offset_(nullptr),
-        end_(nullptr) {}
+        end_(nullptr),
+        finalizers_(nullptr),
+        upstream_(nullptr) {}
+
+  // Hands a fresh block of memory to the arena. In debug builds the entire
+  // block is poisoned until it is allocated.
+  void set_block(std::byte* data, std::size_t capacity) {
+    data_ = data;
+    offset_ = data_;
+    prev_offset_ = nullptr;
+    end_ = data_ + capacity;
+
+    arena_poison(data_, capacity);
+  }
+
+  // Destroys all remaining objects, and unpoisons the block, before it is
+  // given back to whoever owns the memory.
+  void release_block() {
+    finalize();
+
+    if (data_) arena_unpoison(data_, capacity());
+  }
+
+  // Takes the entire state of other, leaving it empty. Used by owning arenas
+  // to implement move semantics.
+  void move_from(base_arena& other) {
+    data_ = other.data_;
+    offset_ = other.offset_;
+    prev_offset_ = other.prev_offset_;
+    end_ = other.end_;
+    finalizers_ = other.finalizers_;
+    upstream_ = other.upstream_;
+#ifdef HTL_ARENA_STATS
+    stats_ = other.stats_;
+    other.stats_ = arena_stats();
+#endif
+
+    other.data_ = nullptr;
+    other.offset_ = nullptr;
+    other.prev_offset_ = nullptr;
+    other.end_ = nullptr;
+    other.finalizers_ = nullptr;
+    other.upstream_ = nullptr;
+  }
+
+  // Runs the finalizers of all objects made after the one with finalizer
+  // last, most recent first.
+  void finalize(finalizer* last = nullptr) {
+    while (finalizers_ != last) {
+      finalizer* fin = finalizers_;
+      finalizers_ = fin->next;
+      fin->destroy(fin->object, fin->count);
+    }
+  }
+
+ private:
+  struct finalizer {
+    void (*destroy)(void*, std::size_t);
+    void* object;
+    std::size_t count;
+    finalizer* next;
+  };
+
+  void* overflow(std::size_t size, std::size_t alignment) {
+    void* out = upstream_ ? upstream_->malloc(size, alignment) : nullptr;
+
+    if (out == nullptr) {
+      record_failure();
+    }
+
+    return out;
+  }
+
+  bool owns(const void* ptr) const {
+    const std::byte* p = reinterpret_cast<const std::byte*>(ptr);
+    return p >= data_ && p < end_;
+  }
+
+  void record_allocation([[maybe_unused]] std::size_t requested,
+                         [[maybe_unused]] std::size_t consumed) {
+#ifdef HTL_ARENA_STATS
+    stats_.allocations++;
+    stats_.bytes_requested += requested;
+    stats_.bytes_consumed += consumed;
+    record_usage();
+#endif
+  }
+
+  void record_growth([[maybe_unused]] std::size_t growth) {
+#ifdef HTL_ARENA_STATS
+    stats_.bytes_requested += growth;
+    stats_.bytes_consumed += growth;
+    record_usage();
+#endif
+  }
+
+  void record_failure() {
+#ifdef HTL_ARENA_STATS
+    stats_.failed_allocations++;
+#endif
+  }
+
+#ifdef HTL_ARENA_STATS
+  void record_usage() {
+    const std::size_t used = static_cast<std::size_t>(offset_ - data_);
+    if (used > stats_.high_water_mark) stats_.high_water_mark = used;
+  }
+#endif
+
+  // Gives back the memory allocated in this block since offset was taken,
+  // such as the finalizer of an object which could not be allocated. Memory
+  // obtained from the upstream arena in the meantime is not given back.
+  void undo(std::byte* offset, std::byte* prev_offset) {
+    if (offset_ > offset) {
+      arena_wipe(offset, static_cast<std::size_t>(offset_ - offset));
+    }
+
+    offset_ = offset;
+    prev_offset_ = prev_offset;
+  }
+
+  finalizer* make_finalizer() {
+    return reinterpret_cast<finalizer*>(
+        malloc(sizeof(finalizer), alignof(finalizer)));
+  }
+
+  template <typename T>
+  void push_finalizer(finalizer* fin, T* object, std::size_t count) {
+    fin->destroy = [](void* ptr, std::size_t n) {
+      T* objects = static_cast<T*>(ptr);
+      while (n > 0) objects[--n].~T();
+    };
+    fin->object = object;
+    fin->count = count;
+    fin->next = finalizers_;
+    finalizers_ = fin;
+  }
+
+  template <typename T>
+  T* allocate_array(std::size_t n) {
+    // Only reject sizes which overflow; malloc decides whether the request
+    // fits, and may pass it on to the upstream arena
+    if (n == 0 || n > SIZE_MAX / sizeof(T)) {
+      return nullptr;
+    }
+
+    return reinterpret_cast<T*>(malloc(n * sizeof(T), alignof(T)));
+  }
 };
 
 }  // namespace details
@@ -265,7 +265,7 @@ inline void load_npy(std::string fname, char*& data_ptr,
                      std::vector<std::size_t>& shape, DType& dtype,
                      bool& c_contiguous) {
   // Open file
-  std::ifstream file(fname);
+  std::ifstream file(fname, std::ios::binary);
 
   // Read magic string
   char* magic_string = new char[6];
@@ -313,7 +313,8 @@ inline void load_npy(std::string fname, char*& data_ptr,
   // Array for header, and read in
   char* header_char = new char[length_of_header];
   file.read(header_char, length_of_header);
-  std::string header(header_char);
+  // The header is not null terminated
+  std::string header(header_char, length_of_header);
 
   // Parse header to get continuity
   std::size_t loc1 = header.find("'fortran_order': ");
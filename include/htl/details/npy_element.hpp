@@ -0,0 +1,22 @@
+#ifndef HTL_DETAILS_NPY_ELEMENT_H
+#define HTL_DETAILS_NPY_ELEMENT_H
+
+#include <cstddef>
+
+namespace htl {
+namespace details {
+
+// The scalar stored in an npy file for an ndarray of T, and how many of them
+// make up one T. Element types made of several scalars specialize this next
+// to their definition, so that every use sees the specialization, and their
+// components become an extra axis of the array in the file.
+template <typename T>
+struct npy_element {
+  using type = T;
+  static constexpr std::size_t components = 1;
+};
+
+}  // namespace details
+}  // namespace htl
+
+#endif
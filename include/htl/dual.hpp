@@ -1,132 +1,363 @@
 #ifndef HTL_DUAL_H
 #define HTL_DUAL_H
 
+#include <array>
 #include <cmath>
 #include <concepts>
+#include <cstddef>
+#include <limits>
+#include <numbers>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "details/npy_element.hpp"
 
 namespace htl {
 
-template <std::floating_point T>
+// A dual number carrying N tangents, so that the derivatives with respect to
+// N inputs are propagated in a single evaluation. The tangents are stored
+// contiguously, and every operation updates them in a simple loop which the
+// compiler can vectorize. With N = std::dynamic_extent, the number of
+// tangents is chosen at run time; a dual with fewer tangents than another
+// is treated as having zeros for the missing ones.
+template <std::floating_point T, std::size_t N = 1>
 class dual {
+  // Fixed size tangents never allocate, while dynamic ones may.
+  static constexpr bool NOTHROW = N != std::dynamic_extent;
+
  public:
   using value_type = T;
+  using size_type = std::size_t;
   using const_reference = const value_type&;
+  using tangent_type = std::conditional_t<N == std::dynamic_extent,
+                                          std::vector<T>, std::array<T, N>>;
 
   constexpr dual(const_reference v = value_type(),
-                 const_reference e = value_type())
-      : value_(v), epsilon_(e) {}
+                 const_reference e = value_type()) noexcept requires(N == 1)
+      : value_(v), epsilon_{e} {}
+
+  constexpr dual(const_reference v = value_type()) noexcept requires(N != 1)
+      : value_(v), epsilon_() {}
+
+  constexpr dual(const_reference v, tangent_type e) noexcept requires(N != 1)
+      : value_(v), epsilon_(std::move(e)) {}
+
+  // Converts from a dual of another precision. Widening conversions are
+  // implicit, while narrowing ones must be explicit.
+  template <std::floating_point U>
+  constexpr explicit(!std::is_same_v<std::common_type_t<T, U>, T>)
+      dual(const dual<U, N>& other) noexcept(NOTHROW)
+      : value_(static_cast<value_type>(other.value())), epsilon_() {
+    const auto e = other.epsilons();
+    if constexpr (N == std::dynamic_extent) epsilon_.resize(e.size());
+    for (size_type i = 0; i < e.size(); i++)
+      epsilon_[i] = static_cast<value_type>(e[i]);
+  }
+
+  // Returns an independent variable, whose i'th tangent is one.
+  [[nodiscard]] static constexpr dual variable(
+      const_reference v, size_type i) requires(N != std::dynamic_extent) {
+    dual out(v);
+    out.epsilon_[i] = value_type(1);
+    return out;
+  }
+
+  [[nodiscard]] static constexpr dual variable(
+      const_reference v, size_type i,
+      size_type n) requires(N == std::dynamic_extent) {
+    dual out(v, tangent_type(n, value_type()));
+    out.epsilon_[i] = value_type(1);
+    return out;
+  }
 
   [[nodiscard]] constexpr value_type value() const { return value_; }
   constexpr void value(value_type v) { value_ = v; }
 
-  [[nodiscard]] constexpr value_type epsilon() const { return epsilon_; }
-  constexpr void epsilon(value_type e) { epsilon_ = e; }
+  [[nodiscard]] constexpr value_type epsilon() const requires(N == 1) {
+    return epsilon_[0];
+  }
+  constexpr void epsilon(value_type e) requires(N == 1) { epsilon_[0] = e; }
+
+  [[nodiscard]] constexpr value_type epsilon(size_type i) const
+      requires(N != 1) {
+    return epsilon_[i];
+  }
+  constexpr void epsilon(size_type i, value_type e) { epsilon_[i] = e; }
 
-  [[nodiscard]] dual operator+() const { return *this; }
+  [[nodiscard]] constexpr std::span<value_type, N> epsilons() {
+    return std::span<value_type, N>(epsilon_);
+  }
 
-  [[nodiscard]] dual operator-() const { return Dual(-value_, -epsilon_); }
+  [[nodiscard]] constexpr std::span<const value_type, N> epsilons() const {
+    return std::span<const value_type, N>(epsilon_);
+  }
 
-  dual& operator+=(const dual& other) {
-    this->value() += other.value();
-    this->epsilon() += other.epsilon();
+  // Number of tangents carried.
+  [[nodiscard]] constexpr size_type directions() const noexcept {
+    return epsilon_.size();
+  }
+
+  [[nodiscard]] constexpr dual operator+() const noexcept(NOTHROW) {
+    return *this;
+  }
+
+  [[nodiscard]] constexpr dual operator-() const
+      noexcept(NOTHROW) {
+    dual out = *this;
+    out.value_ = -out.value_;
+    for (size_type i = 0; i < out.epsilon_.size(); i++)
+      out.epsilon_[i] = -out.epsilon_[i];
+    return out;
+  }
+
+  constexpr dual& operator+=(const dual& other) noexcept(NOTHROW) {
+    const size_type n = match(other);
+    value_ += other.value_;
+    for (size_type i = 0; i < n; i++) epsilon_[i] += other.epsilon_[i];
     return *this;
   }
 
-  dual& operator+=(const_reference v) {
-    this->value() += v;
+  constexpr dual& operator+=(const_reference v) noexcept(NOTHROW) {
+    value_ += v;
     return *this;
   }
 
-  dual& operator-=(const dual& other) {
-    this->value() -= other.value();
-    this->epsilon() -= other.epsilon();
+  constexpr dual& operator-=(const dual& other) noexcept(NOTHROW) {
+    const size_type n = match(other);
+    value_ -= other.value_;
+    for (size_type i = 0; i < n; i++) epsilon_[i] -= other.epsilon_[i];
     return *this;
   }
 
-  dual& operator-=(const_reference v) {
-    this->value() -= v;
+  constexpr dual& operator-=(const_reference v) noexcept(NOTHROW) {
+    value_ -= v;
     return *this;
   }
 
-  dual& operator*=(const dual& other) {
-    this->value() *= other.value();
-    this->epsilon() =
-        this->epsilon() * other.value() + this->value() * other.epsilon();
+  constexpr dual& operator*=(const dual& other) noexcept(NOTHROW) {
+    const size_type n = match(other);
+    const value_type v = value_;
+    const value_type ov = other.value_;
+    for (size_type i = 0; i < n; i++)
+      epsilon_[i] = epsilon_[i] * ov + v * other.epsilon_[i];
+    for (size_type i = n; i < epsilon_.size(); i++) epsilon_[i] *= ov;
+    value_ = v * ov;
     return *this;
   }
 
-  dual& operator*=(const_reference v) {
-    this->value() *= v;
-    this->epsilon() *= v;
+  constexpr dual& operator*=(const_reference v) noexcept(NOTHROW) {
+    value_ *= v;
+    for (size_type i = 0; i < epsilon_.size(); i++) epsilon_[i] *= v;
     return *this;
   }
 
-  dual& operator/=(const dual& other) {
-    this->value() /= other.value();
-    this->epsilon() =
-        (this->epsilon() * other.value() - this->value() * other.epsilon()) /
-        (other.value() * other.value());
+  constexpr dual& operator/=(const dual& other) noexcept(NOTHROW) {
+    const size_type n = match(other);
+    const value_type inv = value_type(1) / other.value_;
+    const value_type v = value_ * inv;
+    for (size_type i = 0; i < n; i++)
+      epsilon_[i] = (epsilon_[i] - v * other.epsilon_[i]) * inv;
+    for (size_type i = n; i < epsilon_.size(); i++) epsilon_[i] *= inv;
+    value_ = v;
     return *this;
   }
 
-  dual& operator/=(const_reference v) {
-    this->value() /= v;
-    this->epsilon() /= v;
+  constexpr dual& operator/=(const_reference v) noexcept(NOTHROW) {
+    value_ /= v;
+    for (size_type i = 0; i < epsilon_.size(); i++) epsilon_[i] /= v;
     return *this;
   }
 
-  [[nodiscard]] dual operator+(const dual& other) const {
+  [[nodiscard]] constexpr dual operator+(const dual& other) const
+      noexcept(NOTHROW) {
     dual out = *this;
     out += other;
     return out;
   }
 
-  [[nodiscard]] dual operator+(const_reference v) const {
+  [[nodiscard]] constexpr dual operator+(const_reference v) const
+      noexcept(NOTHROW) {
     dual out = *this;
     out += v;
     return out;
   }
 
-  [[nodiscard]] dual operator-(const dual& other) const {
+  [[nodiscard]] constexpr dual operator-(const dual& other) const
+      noexcept(NOTHROW) {
     dual out = *this;
     out -= other;
     return out;
   }
 
-  [[nodiscard]] dual operator-(const_reference v) const {
+  [[nodiscard]] constexpr dual operator-(const_reference v) const
+      noexcept(NOTHROW) {
     dual out = *this;
     out -= v;
     return out;
   }
 
-  [[nodiscard]] dual operator*(const dual& other) const {
+  [[nodiscard]] constexpr dual operator*(const dual& other) const
+      noexcept(NOTHROW) {
     dual out = *this;
     out *= other;
     return out;
   }
 
-  [[nodiscard]] dual operator*(const_reference v) const {
+  [[nodiscard]] constexpr dual operator*(const_reference v) const
+      noexcept(NOTHROW) {
     dual out = *this;
     out *= v;
     return out;
   }
 
-  [[nodiscard]] dual operator/(const dual& other) const {
+  [[nodiscard]] constexpr dual operator/(const dual& other) const
+      noexcept(NOTHROW) {
     dual out = *this;
     out /= other;
     return out;
   }
 
-  [[nodiscard]] dual operator/(const_reference v) const {
+  [[nodiscard]] constexpr dual operator/(const_reference v) const
+      noexcept(NOTHROW) {
     dual out = *this;
     out /= v;
     return out;
   }
 
+  // Operators with the scalar on the left. As hidden friends, they accept
+  // anything convertible to value_type, such as an int.
+  [[nodiscard]] friend constexpr dual operator+(
+      const_reference v, const dual& d) noexcept(NOTHROW) {
+    return d + v;
+  }
+
+  [[nodiscard]] friend constexpr dual operator-(
+      const_reference v, const dual& d) noexcept(NOTHROW) {
+    dual out = -d;
+    out.value_ += v;
+    return out;
+  }
+
+  [[nodiscard]] friend constexpr dual operator*(
+      const_reference v, const dual& d) noexcept(NOTHROW) {
+    return d * v;
+  }
+
+  [[nodiscard]] friend constexpr dual operator/(
+      const_reference v, const dual& d) noexcept(NOTHROW) {
+    const value_type inv = value_type(1) / d.value_;
+    dual out = d;
+    out.value_ = v * inv;
+    const value_type df = -out.value_ * inv;
+    for (size_type i = 0; i < out.epsilon_.size(); i++) out.epsilon_[i] *= df;
+    return out;
+  }
+
  private:
-  value_type value_, epsilon_;
+  value_type value_;
+  tangent_type epsilon_;
+
+  // Makes room for every tangent of other, and returns how many it has.
+  constexpr size_type match(const dual& other) {
+    if constexpr (N == std::dynamic_extent) {
+      if (epsilon_.size() < other.epsilon_.size())
+        epsilon_.resize(other.epsilon_.size(), value_type());
+      return other.epsilon_.size();
+    } else {
+      return N;
+    }
+  }
+};
+
+namespace details {
+
+// A dual<T, N> is stored in an npy file as N + 1 scalars: its value followed
+// by its tangents.
+template <std::floating_point T, std::size_t N>
+requires(N != std::dynamic_extent)
+struct npy_element<dual<T, N>> {
+  static_assert(sizeof(dual<T, N>) == (N + 1) * sizeof(T));
+
+  using type = T;
+  static constexpr std::size_t components = N + 1;
 };
 
+}  // namespace details
+
+//==========================================================
+// Mixed precision arithmetic, which promotes like the scalar types do, so
+// that a dual<float> and a dual<double> give a dual<double>.
+template <typename T, typename U, std::size_t N>
+requires(!std::is_same_v<T, U>)
+[[nodiscard]] constexpr dual<std::common_type_t<T, U>, N> operator+(
+    const dual<T, N>& a, const dual<U, N>& b) {
+  using R = std::common_type_t<T, U>;
+  return dual<R, N>(a) + dual<R, N>(b);
+}
+
+template <typename T, typename U, std::size_t N>
+requires(!std::is_same_v<T, U>)
+[[nodiscard]] constexpr dual<std::common_type_t<T, U>, N> operator-(
+    const dual<T, N>& a, const dual<U, N>& b) {
+  using R = std::common_type_t<T, U>;
+  return dual<R, N>(a) - dual<R, N>(b);
+}
+
+template <typename T, typename U, std::size_t N>
+requires(!std::is_same_v<T, U>)
+[[nodiscard]] constexpr dual<std::common_type_t<T, U>, N> operator*(
+    const dual<T, N>& a, const dual<U, N>& b) {
+  using R = std::common_type_t<T, U>;
+  return dual<R, N>(a) * dual<R, N>(b);
+}
+
+template <typename T, typename U, std::size_t N>
+requires(!std::is_same_v<T, U>)
+[[nodiscard]] constexpr dual<std::common_type_t<T, U>, N> operator/(
+    const dual<T, N>& a, const dual<U, N>& b) {
+  using R = std::common_type_t<T, U>;
+  return dual<R, N>(a) / dual<R, N>(b);
+}
+
+namespace details {
+
+// Applies the chain rule to a function of one variable, given its value f
+// and derivative df at arg.value().
+template <typename T, std::size_t N>
+[[nodiscard]] constexpr dual<T, N> chain(dual<T, N> arg, T f, T df) {
+  arg.value(f);
+  for (auto& e : arg.epsilons()) e *= df;
+  return arg;
+}
+
+// Applies the chain rule to a function of two variables, given its value f
+// and partial derivatives da and db.
+template <typename T, std::size_t N>
+[[nodiscard]] constexpr dual<T, N> chain(const dual<T, N>& a,
+                                         const dual<T, N>& b, T f, T da,
+                                         T db) {
+  // Start from whichever has more tangents, which only matters when the
+  // number of tangents is dynamic.
+  const bool a_wider = a.directions() >= b.directions();
+  dual<T, N> out = a_wider ? a : b;
+  const dual<T, N>& other = a_wider ? b : a;
+  const T d_out = a_wider ? da : db;
+  const T d_other = a_wider ? db : da;
+
+  out.value(f);
+  auto e = out.epsilons();
+  auto oe = other.epsilons();
+  for (std::size_t i = 0; i < oe.size(); i++)
+    e[i] = e[i] * d_out + oe[i] * d_other;
+  for (std::size_t i = oe.size(); i < e.size(); i++) e[i] *= d_out;
+
+  return out;
+}
+
+}  // namespace details
+
 //==========================================================
 // abs
 template <typename T>
@@ -134,10 +365,11 @@ template <typename T>
   return std::abs(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> abs(dual<T> arg) {
-  return dual<T>(std::abs(arg.value()),
-                 arg.value() >= 0. ? arg.epsilon() : -arg.epsilon());
+template <typename T, std::size_t N>
+[[nodiscard]] constexpr dual<T, N> abs(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), v >= T(0) ? v : -v,
+                        v >= T(0) ? T(1) : T(-1));
 }
 
 //==========================================================
@@ -147,16 +379,32 @@ template <typename T1, typename T2>
   return std::pow(base, exp);
 }
 
-template <typename T1, typename T2>
-[[nodiscard]] dual<T1> pow(dual<T1> base, T2 exp) {
-  return dual<T1>(std::pow(base.value(), exp),
-                  base.epsilon() * exp * std::pow(base.value(), exp - 1.));
+// The derivative p v^(p-1) is found from the value as p f / v, which saves a
+// second call to std::pow.
+template <typename T1, std::size_t N, typename T2>
+[[nodiscard]] dual<T1, N> pow(dual<T1, N> base, T2 exp) {
+  const T1 v = base.value();
+  const T1 p = static_cast<T1>(exp);
+  const T1 f = std::pow(v, p);
+  const T1 df = v != T1(0) ? p * f / v : p * std::pow(v, p - T1(1));
+  return details::chain(std::move(base), f, df);
 }
 
-template <typename T1, typename T2>
-[[nodiscard]] dual<T2> pow(T1 base, dual<T2> exp) {
+template <typename T1, typename T2, std::size_t N>
+[[nodiscard]] dual<T2, N> pow(T1 base, dual<T2, N> exp) {
   const T2 out_val = std::pow(base, exp.value());
-  return dual<T2>(out_val, exp.epsilon() * out_val * std::log(base));
+  return details::chain(std::move(exp), out_val,
+                        T2(out_val * std::log(base)));
+}
+
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> pow(const dual<T, N>& base, const dual<T, N>& exp) {
+  const T v = base.value();
+  const T p = exp.value();
+  const T f = std::pow(v, p);
+  const T d_base = v != T(0) ? p * f / v : p * std::pow(v, p - T(1));
+  const T d_exp = v > T(0) ? f * std::log(v) : T(0);
+  return details::chain(base, exp, f, d_base, d_exp);
 }
 
 //==========================================================
@@ -166,10 +414,10 @@ template <typename T>
   return std::sqrt(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> sqrt(dual<T> arg) {
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> sqrt(dual<T, N> arg) {
   const T sqrt_value = std::sqrt(arg.value());
-  return dual<T>(sqrt_value, 0.5 * arg.epsilon() / sqrt_value);
+  return details::chain(std::move(arg), sqrt_value, T(0.5) / sqrt_value);
 }
 
 //==========================================================
@@ -179,12 +427,11 @@ template <typename T>
   return std::cbrt(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> cbrt(dual<T> arg) {
-  constexpr T one_third = 1. / 3.;
-  return dual<T>(
-      std::cbrt(arg.value()),
-      one_third * arg.epsilon() / (std::pow(arg.value(), 2. * one_third)));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> cbrt(dual<T, N> arg) {
+  const T cbrt_value = std::cbrt(arg.value());
+  return details::chain(std::move(arg), cbrt_value,
+                        T(1) / (T(3) * cbrt_value * cbrt_value));
 }
 
 //==========================================================
@@ -194,10 +441,10 @@ template <typename T>
   return std::exp(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> exp(dual<T> arg) {
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> exp(dual<T, N> arg) {
   const T exp_value = std::exp(arg.value());
-  return dual<T>(exp_value, arg.epsilon() * exp_value);
+  return details::chain(std::move(arg), exp_value, exp_value);
 }
 
 //==========================================================
@@ -207,10 +454,11 @@ template <typename T>
   return std::exp2(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> exp2(dual<T> arg) {
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> exp2(dual<T, N> arg) {
   const T exp2_value = std::exp2(arg.value());
-  return dual<T>(exp2_value, arg.epsilon() * exp2_value * std::log(2.));
+  return details::chain(std::move(arg), exp2_value,
+                        exp2_value * std::log(T(2)));
 }
 
 //==========================================================
@@ -220,11 +468,10 @@ template <typename T>
   return std::expm1(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> expm1(dual<T> arg) {
-  dual<T> out = exp(arg);
-  out.value() -= 1.;
-  return out;
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> expm1(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::expm1(v), std::exp(v));
 }
 
 //==========================================================
@@ -234,9 +481,10 @@ template <typename T>
   return std::log(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> log(dual<T> arg) {
-  return dual<T>(std::log(arg.value()), arg.epsilon() / arg.value());
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> log(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::log(v), T(1) / v);
 }
 
 //==========================================================
@@ -246,10 +494,11 @@ template <typename T>
   return std::log2(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> log2(dual<T> arg) {
-  return dual<T>(std::log2(arg.value()),
-                 arg.epsilon() / (arg.value() * std::log(2.)));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> log2(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::log2(v),
+                        T(1) / (v * std::log(T(2))));
 }
 
 //==========================================================
@@ -259,10 +508,11 @@ template <typename T>
   return std::log10(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> log10(dual<T> arg) {
-  return dual<T>(std::log10(arg.value()),
-                 arg.epsilon() / (arg.value() * std::log(10.)));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> log10(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::log10(v),
+                        T(1) / (v * std::log(T(10))));
 }
 
 //==========================================================
@@ -272,9 +522,10 @@ template <typename T>
   return std::log1p(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> log1p(dual<T> arg) {
-  return dual<T>(std::log1p(arg.value()), arg.epsilon() / (1. + arg.value()));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> log1p(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::log1p(v), T(1) / (T(1) + v));
 }
 
 //==========================================================
@@ -284,9 +535,11 @@ template <typename T>
   return std::sin(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> sin(dual<T> arg) {
-  return dual<T>(std::sin(arg.value()), arg.epsilon() * std::cos(arg.value()));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> sin(dual<T, N> arg) {
+  // Compilers merge the sin and cos of one argument into one sincos call
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::sin(v), std::cos(v));
 }
 
 //==========================================================
@@ -296,9 +549,23 @@ template <typename T>
   return std::cos(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> cos(dual<T> arg) {
-  return dual<T>(std::cos(arg.value()), -arg.epsilon() * std::sin(arg.value()));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> cos(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::cos(v), -std::sin(v));
+}
+
+//==========================================================
+// sincos
+// Returns the sine and cosine of arg together. Each is the derivative of the
+// other, so both come from a single sincos evaluation.
+template <typename T, std::size_t N>
+[[nodiscard]] std::pair<dual<T, N>, dual<T, N>> sincos(const dual<T, N>& arg) {
+  const T v = arg.value();
+  const T sin_val = std::sin(v);
+  const T cos_val = std::cos(v);
+  return {details::chain(arg, sin_val, cos_val),
+          details::chain(arg, cos_val, -sin_val)};
 }
 
 //==========================================================
@@ -308,10 +575,10 @@ template <typename T>
   return std::tan(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> tan(dual<T> arg) {
-  const T cos_val = std::cos(arg.value());
-  return dual<T>(std::tan(arg.value()), arg.epsilon() / (cos_val * cos_val));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> tan(dual<T, N> arg) {
+  const T tan_val = std::tan(arg.value());
+  return details::chain(std::move(arg), tan_val, T(1) + tan_val * tan_val);
 }
 
 //==========================================================
@@ -321,11 +588,11 @@ template <typename T>
   return std::asin(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> asin(dual<T> arg) {
-  const T val_sqrd = arg.value() * arg.value();
-  return dual<T>(std::asin(arg.value()),
-                 arg.epsilon() / std::sqrt(1. - val_sqrd));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> asin(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::asin(v),
+                        T(1) / std::sqrt(T(1) - v * v));
 }
 
 //==========================================================
@@ -335,11 +602,11 @@ template <typename T>
   return std::acos(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> acos(dual<T> arg) {
-  const T val_sqrd = arg.value() * arg.value();
-  return dual<T>(std::acos(arg.value()),
-                 -arg.epsilon() / std::sqrt(1. - val_sqrd));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> acos(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::acos(v),
+                        T(-1) / std::sqrt(T(1) - v * v));
 }
 
 //==========================================================
@@ -349,31 +616,91 @@ template <typename T>
   return std::atan(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> atan(dual<T> arg) {
-  const T val_sqrd = arg.value() * arg.value();
-  return dual<T>(std::atan(arg.value()), arg.epsilon() / (1. + val_sqrd));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> atan(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::atan(v), T(1) / (T(1) + v * v));
 }
 
 //==========================================================
 // atan2
 template <typename T1, typename T2>
-[[nodiscard]] auto atan2(T2 y, T2 x) {
+[[nodiscard]] auto atan2(T1 y, T2 x) {
   return std::atan2(y, x);
 }
 
-template <typename T1, typename T2>
-[[nodiscard]] dual<T1> atan2(dual<T1> y, T2 x) {
-  const T1 deriv = -y.value() / (x * x + y.value() * y.value());
-  return dual<T1>(std::atan2(y.value(), x), y.epsilon() * deriv);
+template <typename T1, std::size_t N, typename T2>
+[[nodiscard]] dual<T1, N> atan2(dual<T1, N> y, T2 x) {
+  const T1 v = y.value();
+  const T1 deriv = x / (x * x + v * v);
+  return details::chain(std::move(y), T1(std::atan2(v, x)), deriv);
+}
+
+template <typename T1, typename T2, std::size_t N>
+[[nodiscard]] dual<T2, N> atan2(T1 y, dual<T2, N> x) {
+  const T2 v = x.value();
+  const T2 deriv = -y / (v * v + y * y);
+  return details::chain(std::move(x), T2(std::atan2(y, v)), deriv);
+}
+
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> atan2(const dual<T, N>& y, const dual<T, N>& x) {
+  const T yv = y.value();
+  const T xv = x.value();
+  const T inv = T(1) / (xv * xv + yv * yv);
+  return details::chain(y, x, std::atan2(yv, xv), xv * inv, -yv * inv);
 }
 
+//==========================================================
+// hypot
 template <typename T1, typename T2>
-[[nodiscard]] dual<T2> atan2(T1 y, dual<T2> x) {
-  const T2 deriv = x.value() / (x.value() * x.value() + y * y);
-  return dual<T2>(std::atan2(y, x.value()), x.epsilon() * deriv);
+[[nodiscard]] auto hypot(T1 x, T2 y) {
+  return std::hypot(x, y);
+}
+
+template <typename T1, std::size_t N, typename T2>
+[[nodiscard]] dual<T1, N> hypot(dual<T1, N> x, T2 y) {
+  const T1 h = std::hypot(x.value(), static_cast<T1>(y));
+  const T1 v = x.value();
+  return details::chain(std::move(x), h, h != T1(0) ? v / h : T1(0));
 }
 
+template <typename T1, typename T2, std::size_t N>
+[[nodiscard]] dual<T2, N> hypot(T1 x, dual<T2, N> y) {
+  return hypot(std::move(y), x);
+}
+
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> hypot(const dual<T, N>& x, const dual<T, N>& y) {
+  const T h = std::hypot(x.value(), y.value());
+  const T inv = h != T(0) ? T(1) / h : T(0);
+  return details::chain(x, y, h, x.value() * inv, y.value() * inv);
+}
+
+namespace details {
+
+// sinh and cosh of v, both built from one call to expm1, which stays
+// accurate for small arguments where exp(v) - exp(-v) would cancel. The
+// work is done on |v|, as sinh is odd and cosh even. Once exp(|v|)
+// overflows, sinh and cosh may still be finite, so the std functions are
+// used instead.
+template <std::floating_point T>
+inline constexpr T sinh_cosh_max_arg =
+    T(std::numeric_limits<T>::max_exponent - 1) * std::numbers::ln2_v<T>;
+
+template <std::floating_point T>
+[[nodiscard]] std::pair<T, T> sinh_cosh(T v) {
+  const T a = std::abs(v);
+  if (a > sinh_cosh_max_arg<T>) return {std::sinh(v), std::cosh(v)};
+
+  const T em1 = std::expm1(a);
+  const T e = em1 + T(1);
+  return {std::copysign(T(0.5) * (em1 + em1 / e), v),
+          T(0.5) * (e + T(1) / e)};
+}
+
+}  // namespace details
+
 //==========================================================
 // sinh
 template <typename T>
@@ -381,10 +708,10 @@ template <typename T>
   return std::sinh(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> sinh(dual<T> arg) {
-  return dual<T>(std::sinh(arg.value()),
-                 arg.epsilon() * std::cosh(arg.value()));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> sinh(dual<T, N> arg) {
+  const auto [sinh_val, cosh_val] = details::sinh_cosh(arg.value());
+  return details::chain(std::move(arg), sinh_val, cosh_val);
 }
 
 //==========================================================
@@ -394,23 +721,36 @@ template <typename T>
   return std::cosh(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> cosh(dual<T> arg) {
-  return dual<T>(std::cosh(arg.value()),
-                 arg.epsilon() * std::sinh(arg.value()));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> cosh(dual<T, N> arg) {
+  const auto [sinh_val, cosh_val] = details::sinh_cosh(arg.value());
+  return details::chain(std::move(arg), cosh_val, sinh_val);
+}
+
+//==========================================================
+// sinhcosh
+// Returns the hyperbolic sine and cosine of arg together, from one expm1.
+template <typename T, std::size_t N>
+[[nodiscard]] std::pair<dual<T, N>, dual<T, N>> sinhcosh(
+    const dual<T, N>& arg) {
+  const auto [sinh_val, cosh_val] = details::sinh_cosh(arg.value());
+  return {details::chain(arg, sinh_val, cosh_val),
+          details::chain(arg, cosh_val, sinh_val)};
 }
 
 //==========================================================
 // tanh
 template <typename T>
 [[nodiscard]] auto tanh(T arg) {
-  return std::tan(arg);
+  return std::tanh(arg);
 }
 
-template <typename T>
-dual<T> tanh(dual<T> arg) {
-  const T cosh_val = std::cosh(arg.value());
-  return dual<T>(std::tanh(arg.value()), arg.epsilon() / (cosh_val * cosh_val));
+// The derivative 1 / cosh^2 equals 1 - tanh^2, so no cosh is needed.
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> tanh(dual<T, N> arg) {
+  const T tanh_val = std::tanh(arg.value());
+  return details::chain(std::move(arg), tanh_val,
+                        T(1) - tanh_val * tanh_val);
 }
 
 //==========================================================
@@ -420,11 +760,11 @@ template <typename T>
   return std::asinh(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> asinh(dual<T> arg) {
-  const T val_sqrd = arg.value() * arg.value();
-  return dual<T>(std::asinh(arg.value()),
-                 arg.epsilon() / std::sqrt(1. + val_sqrd));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> asinh(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::asinh(v),
+                        T(1) / std::sqrt(T(1) + v * v));
 }
 
 //==========================================================
@@ -434,11 +774,11 @@ template <typename T>
   return std::acosh(arg);
 }
 
-template <typename T>
-[[nodiscard]] dual<T> acosh(dual<T> arg) {
-  const T val_sqrd = arg.value() * arg.value();
-  return dual<T>(std::acosh(arg.value()),
-                 arg.epsilon() / std::sqrt(val_sqrd - 1.));
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> acosh(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::acosh(v),
+                        T(1) / std::sqrt(v * v - T(1)));
 }
 
 //==========================================================
@@ -448,12 +788,91 @@ template <typename T>
   return std::atanh(arg);
 }
 
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> atanh(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(std::move(arg), std::atanh(v), T(1) / (T(1) - v * v));
+}
+
+//==========================================================
+// erf
+template <typename T>
+[[nodiscard]] auto erf(T arg) {
+  return std::erf(arg);
+}
+
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> erf(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(
+      std::move(arg), std::erf(v),
+      T(2) * std::numbers::inv_sqrtpi_v<T> * std::exp(-v * v));
+}
+
+//==========================================================
+// erfc
 template <typename T>
-[[nodiscard]] dual<T> atanh(dual<T> arg) {
-  const T val_sqrd = arg.value() * arg.value();
-  return dual<T>(std::atanh(arg.value()), arg.epsilon() / (1. - val_sqrd));
+[[nodiscard]] auto erfc(T arg) {
+  return std::erfc(arg);
+}
+
+template <typename T, std::size_t N>
+[[nodiscard]] dual<T, N> erfc(dual<T, N> arg) {
+  const T v = arg.value();
+  return details::chain(
+      std::move(arg), std::erfc(v),
+      T(-2) * std::numbers::inv_sqrtpi_v<T> * std::exp(-v * v));
+}
+
+//==========================================================
+// fma
+template <typename T1, typename T2, typename T3>
+[[nodiscard]] auto fma(T1 a, T2 b, T3 c) {
+  return std::fma(a, b, c);
+}
+
+// Computes a * b + c with one rounding of the value, and the tangents of the
+// product and the sum in a single pass.
+template <typename T, std::size_t N>
+[[nodiscard]] constexpr dual<T, N> fma(const dual<T, N>& a,
+                                       const dual<T, N>& b,
+                                       const dual<T, N>& c) {
+  dual<T, N> out = details::chain(a, b, T(0), b.value(), a.value());
+  out += c;
+  if (std::is_constant_evaluated()) {
+    out.value(a.value() * b.value() + c.value());
+  } else {
+    out.value(std::fma(a.value(), b.value(), c.value()));
+  }
+  return out;
+}
+
+//==========================================================
+// min
+// Unlike the other functions, min and max have no fallback for plain
+// numbers, which would be ambiguous with std::min and std::max.
+// At a tie, the first argument and its tangents are returned.
+template <typename T, std::size_t N>
+[[nodiscard]] constexpr dual<T, N> min(const dual<T, N>& a,
+                                       const dual<T, N>& b) {
+  return b.value() < a.value() ? b : a;
+}
+
+//==========================================================
+// max
+template <typename T, std::size_t N>
+[[nodiscard]] constexpr dual<T, N> max(const dual<T, N>& a,
+                                       const dual<T, N>& b) {
+  return a.value() < b.value() ? b : a;
 }
 
 }  // namespace htl
 
+// Lets generic code find the promoted type of two duals of different
+// precision, as with the operators above.
+template <typename T, typename U, std::size_t N>
+struct std::common_type<htl::dual<T, N>, htl::dual<U, N>> {
+  using type = htl::dual<std::common_type_t<T, U>, N>;
+};
+
 #endif
@@ -0,0 +1,523 @@
+#ifndef HTL_DUAL_ARRAY_H
+#define HTL_DUAL_ARRAY_H
+
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "dual.hpp"
+#include "ndarray.hpp"
+
+namespace htl {
+
+// An array of dual numbers, stored as two separate planes: one ndarray of
+// values, and one of epsilons. Unlike a std::vector<dual<T>>, where values
+// and epsilons are interleaved, every operation here is a plain loop over
+// contiguous values, which the compiler can vectorize. The math functions
+// first compute all of the values, and then all of the epsilons. Only when
+// built with -ffast-math (or -Ofast) do GCC and Clang turn the loops over
+// exp, sin, pow, etc. into calls to the vector math library (libmvec or
+// SVML); otherwise they remain one scalar call per element.
+template <std::floating_point T, typename Allocator = std::allocator<T>>
+class dual_array {
+ public:
+  using value_type = dual<T>;
+  using scalar_type = T;
+  using allocator_type = Allocator;
+  using size_type = std::size_t;
+  using array_type = ndarray<T, Allocator>;
+
+  dual_array() : values_(), epsilons_() {}
+
+  explicit dual_array(const allocator_type& alloc)
+      : values_(alloc), epsilons_(alloc) {}
+
+  dual_array(const std::vector<size_type>& init_shape,
+             bool c_continuous = true,
+             const allocator_type& alloc = allocator_type())
+      : values_(init_shape, c_continuous, alloc),
+        epsilons_(init_shape, c_continuous, alloc) {}
+
+  dual_array(std::initializer_list<size_type> init_shape,
+             bool c_continuous = true,
+             const allocator_type& alloc = allocator_type())
+      : values_(init_shape, c_continuous, alloc),
+        epsilons_(init_shape, c_continuous, alloc) {}
+
+  dual_array(array_type values, array_type epsilons)
+      : values_(std::move(values)), epsilons_(std::move(epsilons)) {
+    if (values_.shape() != epsilons_.shape() ||
+        values_.c_continuous() != epsilons_.c_continuous()) {
+      throw std::runtime_error(
+          "htl::dual_array: values and epsilons must have the same shape and "
+          "ordering");
+    }
+  }
+
+  [[nodiscard]] value_type operator[](size_type i) const {
+    return value_type(values_[i], epsilons_[i]);
+  }
+
+  void set(size_type i, const value_type& d) {
+    values_[i] = d.value();
+    epsilons_[i] = d.epsilon();
+  }
+
+  [[nodiscard]] array_type& values() { return values_; }
+  [[nodiscard]] const array_type& values() const { return values_; }
+
+  [[nodiscard]] array_type& epsilons() { return epsilons_; }
+  [[nodiscard]] const array_type& epsilons() const { return epsilons_; }
+
+  [[nodiscard]] const typename array_type::shape_type& shape() const {
+    return values_.shape();
+  }
+
+  [[nodiscard]] size_type size() const { return values_.size(); }
+
+  [[nodiscard]] bool c_continuous() const { return values_.c_continuous(); }
+
+  [[nodiscard]] allocator_type get_allocator() const {
+    return values_.get_allocator();
+  }
+
+  void reshape(std::span<const size_type> new_shape) {
+    values_.reshape(new_shape);
+    epsilons_.reshape(new_shape);
+  }
+
+  void reshape(std::initializer_list<size_type> new_shape) {
+    reshape(std::span<const size_type>(new_shape.begin(), new_shape.size()));
+  }
+
+  void reallocate(std::span<const size_type> new_shape) {
+    values_.reallocate(new_shape);
+    epsilons_.reallocate(new_shape);
+  }
+
+  void reallocate(std::initializer_list<size_type> new_shape) {
+    reallocate(
+        std::span<const size_type>(new_shape.begin(), new_shape.size()));
+  }
+
+  dual_array& operator+=(const dual_array& other) {
+    check_size(other);
+    T* v = values_.data();
+    T* e = epsilons_.data();
+    const T* ov = other.values_.data();
+    const T* oe = other.epsilons_.data();
+    for (size_type i = 0; i < size(); i++) v[i] += ov[i];
+    for (size_type i = 0; i < size(); i++) e[i] += oe[i];
+    return *this;
+  }
+
+  dual_array& operator+=(T s) {
+    T* v = values_.data();
+    for (size_type i = 0; i < size(); i++) v[i] += s;
+    return *this;
+  }
+
+  dual_array& operator-=(const dual_array& other) {
+    check_size(other);
+    T* v = values_.data();
+    T* e = epsilons_.data();
+    const T* ov = other.values_.data();
+    const T* oe = other.epsilons_.data();
+    for (size_type i = 0; i < size(); i++) v[i] -= ov[i];
+    for (size_type i = 0; i < size(); i++) e[i] -= oe[i];
+    return *this;
+  }
+
+  dual_array& operator-=(T s) {
+    T* v = values_.data();
+    for (size_type i = 0; i < size(); i++) v[i] -= s;
+    return *this;
+  }
+
+  dual_array& operator*=(const dual_array& other) {
+    check_size(other);
+    T* v = values_.data();
+    T* e = epsilons_.data();
+    const T* ov = other.values_.data();
+    const T* oe = other.epsilons_.data();
+    for (size_type i = 0; i < size(); i++) {
+      e[i] = e[i] * ov[i] + v[i] * oe[i];
+    }
+    for (size_type i = 0; i < size(); i++) v[i] *= ov[i];
+    return *this;
+  }
+
+  dual_array& operator*=(T s) {
+    T* v = values_.data();
+    T* e = epsilons_.data();
+    for (size_type i = 0; i < size(); i++) v[i] *= s;
+    for (size_type i = 0; i < size(); i++) e[i] *= s;
+    return *this;
+  }
+
+  dual_array& operator/=(const dual_array& other) {
+    check_size(other);
+    T* v = values_.data();
+    T* e = epsilons_.data();
+    const T* ov = other.values_.data();
+    const T* oe = other.epsilons_.data();
+    for (size_type i = 0; i < size(); i++) v[i] /= ov[i];
+    for (size_type i = 0; i < size(); i++) {
+      e[i] = (e[i] - v[i] * oe[i]) / ov[i];
+    }
+    return *this;
+  }
+
+  dual_array& operator/=(T s) {
+    T* v = values_.data();
+    T* e = epsilons_.data();
+    for (size_type i = 0; i < size(); i++) v[i] /= s;
+    for (size_type i = 0; i < size(); i++) e[i] /= s;
+    return *this;
+  }
+
+  [[nodiscard]] dual_array operator-() const {
+    dual_array out = *this;
+    out *= T(-1);
+    return out;
+  }
+
+  [[nodiscard]] dual_array operator+(const dual_array& other) const {
+    dual_array out = *this;
+    out += other;
+    return out;
+  }
+
+  [[nodiscard]] dual_array operator+(T s) const {
+    dual_array out = *this;
+    out += s;
+    return out;
+  }
+
+  [[nodiscard]] dual_array operator-(const dual_array& other) const {
+    dual_array out = *this;
+    out -= other;
+    return out;
+  }
+
+  [[nodiscard]] dual_array operator-(T s) const {
+    dual_array out = *this;
+    out -= s;
+    return out;
+  }
+
+  [[nodiscard]] dual_array operator*(const dual_array& other) const {
+    dual_array out = *this;
+    out *= other;
+    return out;
+  }
+
+  [[nodiscard]] dual_array operator*(T s) const {
+    dual_array out = *this;
+    out *= s;
+    return out;
+  }
+
+  [[nodiscard]] dual_array operator/(const dual_array& other) const {
+    dual_array out = *this;
+    out /= other;
+    return out;
+  }
+
+  [[nodiscard]] dual_array operator/(T s) const {
+    dual_array out = *this;
+    out /= s;
+    return out;
+  }
+
+ private:
+  array_type values_;
+  array_type epsilons_;
+
+  void check_size(const dual_array& other) const {
+    if (other.shape() != shape() || other.c_continuous() != c_continuous()) {
+      throw std::runtime_error(
+          "htl::dual_array: arrays must have the same shape and ordering");
+    }
+  }
+};
+
+namespace details {
+
+// Applies f to every element of x. The values are computed first, in one
+// loop, and the epsilons in a second loop, from the derivative df(v, f(v)).
+template <typename T, typename A, typename F, typename DF>
+[[nodiscard]] dual_array<T, A> batch(const dual_array<T, A>& x, F f, DF df) {
+  dual_array<T, A> out = x;
+  const std::size_t n = x.size();
+  const T* xv = x.values().data();
+  const T* xe = x.epsilons().data();
+  T* ov = out.values().data();
+  T* oe = out.epsilons().data();
+
+  for (std::size_t i = 0; i < n; i++) ov[i] = f(xv[i]);
+  for (std::size_t i = 0; i < n; i++) oe[i] = xe[i] * df(xv[i], ov[i]);
+
+  return out;
+}
+
+// sinh or cosh of every element of x, with the other one as derivative.
+// Both come from one expm1 of |v|, as in details::sinh_cosh. The elements
+// where exp(|v|) overflows are redone with std::sinh and std::cosh in a last
+// loop, only run if there are any, which keeps the first two free of
+// branches.
+template <bool Sinh, typename T, typename A>
+[[nodiscard]] dual_array<T, A> batch_sinh_cosh(const dual_array<T, A>& x) {
+  dual_array<T, A> out = x;
+  const std::size_t n = x.size();
+  const T* xv = x.values().data();
+  const T* xe = x.epsilons().data();
+  T* ov = out.values().data();
+  T* oe = out.epsilons().data();
+
+  // The values hold expm1(|v|) until the second loop
+  for (std::size_t i = 0; i < n; i++) ov[i] = std::expm1(std::abs(xv[i]));
+
+  int overflow = 0;
+  for (std::size_t i = 0; i < n; i++) {
+    overflow |= std::abs(xv[i]) > sinh_cosh_max_arg<T>;
+    const T em1 = ov[i];
+    const T e = em1 + T(1);
+    const T sinh_val = std::copysign(T(0.5) * (em1 + em1 / e), xv[i]);
+    const T cosh_val = T(0.5) * (e + T(1) / e);
+    ov[i] = Sinh ? sinh_val : cosh_val;
+    oe[i] = xe[i] * (Sinh ? cosh_val : sinh_val);
+  }
+
+  // Otherwise the compiler may vectorize this loop too, and compute sinh and
+  // cosh of every element
+  if (!overflow) return out;
+
+  for (std::size_t i = 0; i < n; i++) {
+    if (std::abs(xv[i]) > sinh_cosh_max_arg<T>) {
+      const T sinh_val = std::sinh(xv[i]);
+      const T cosh_val = std::cosh(xv[i]);
+      ov[i] = Sinh ? sinh_val : cosh_val;
+      oe[i] = xe[i] * (Sinh ? cosh_val : sinh_val);
+    }
+  }
+
+  return out;
+}
+
+}  // namespace details
+
+//==========================================================
+// abs
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> abs(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::abs(v); },
+      [](T v, T) { return v >= T(0) ? T(1) : T(-1); });
+}
+
+//==========================================================
+// pow
+template <typename T, typename A, typename U>
+[[nodiscard]] dual_array<T, A> pow(const dual_array<T, A>& x, U exp) {
+  const T p = static_cast<T>(exp);
+  return details::batch(
+      x, [p](T v) { return std::pow(v, p); },
+      [p](T v, T f) {
+        return v != T(0) ? p * f / v : p * std::pow(v, p - T(1));
+      });
+}
+
+//==========================================================
+// sqrt
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> sqrt(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::sqrt(v); },
+      [](T, T f) { return T(0.5) / f; });
+}
+
+//==========================================================
+// cbrt
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> cbrt(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::cbrt(v); },
+      [](T, T f) { return T(1) / (T(3) * f * f); });
+}
+
+//==========================================================
+// exp
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> exp(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::exp(v); }, [](T, T f) { return f; });
+}
+
+//==========================================================
+// exp2
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> exp2(const dual_array<T, A>& x) {
+  const T ln2 = std::log(T(2));
+  return details::batch(
+      x, [](T v) { return std::exp2(v); },
+      [ln2](T, T f) { return f * ln2; });
+}
+
+//==========================================================
+// expm1
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> expm1(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::expm1(v); },
+      [](T, T f) { return f + T(1); });
+}
+
+//==========================================================
+// log
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> log(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::log(v); }, [](T v, T) { return T(1) / v; });
+}
+
+//==========================================================
+// log2
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> log2(const dual_array<T, A>& x) {
+  const T inv_ln2 = T(1) / std::log(T(2));
+  return details::batch(
+      x, [](T v) { return std::log2(v); },
+      [inv_ln2](T v, T) { return inv_ln2 / v; });
+}
+
+//==========================================================
+// log10
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> log10(const dual_array<T, A>& x) {
+  const T inv_ln10 = T(1) / std::log(T(10));
+  return details::batch(
+      x, [](T v) { return std::log10(v); },
+      [inv_ln10](T v, T) { return inv_ln10 / v; });
+}
+
+//==========================================================
+// log1p
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> log1p(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::log1p(v); },
+      [](T v, T) { return T(1) / (T(1) + v); });
+}
+
+//==========================================================
+// sin
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> sin(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::sin(v); }, [](T v, T) { return std::cos(v); });
+}
+
+//==========================================================
+// cos
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> cos(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::cos(v); }, [](T v, T) { return -std::sin(v); });
+}
+
+//==========================================================
+// tan
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> tan(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::tan(v); },
+      [](T, T f) { return T(1) + f * f; });
+}
+
+//==========================================================
+// asin
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> asin(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::asin(v); },
+      [](T v, T) { return T(1) / std::sqrt(T(1) - v * v); });
+}
+
+//==========================================================
+// acos
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> acos(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::acos(v); },
+      [](T v, T) { return T(-1) / std::sqrt(T(1) - v * v); });
+}
+
+//==========================================================
+// atan
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> atan(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::atan(v); },
+      [](T v, T) { return T(1) / (T(1) + v * v); });
+}
+
+//==========================================================
+// sinh
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> sinh(const dual_array<T, A>& x) {
+  return details::batch_sinh_cosh<true>(x);
+}
+
+//==========================================================
+// cosh
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> cosh(const dual_array<T, A>& x) {
+  return details::batch_sinh_cosh<false>(x);
+}
+
+//==========================================================
+// tanh
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> tanh(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::tanh(v); },
+      [](T, T f) { return T(1) - f * f; });
+}
+
+//==========================================================
+// asinh
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> asinh(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::asinh(v); },
+      [](T v, T) { return T(1) / std::sqrt(T(1) + v * v); });
+}
+
+//==========================================================
+// acosh
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> acosh(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::acosh(v); },
+      [](T v, T) { return T(1) / std::sqrt(v * v - T(1)); });
+}
+
+//==========================================================
+// atanh
+template <typename T, typename A>
+[[nodiscard]] dual_array<T, A> atanh(const dual_array<T, A>& x) {
+  return details::batch(
+      x, [](T v) { return std::atanh(v); },
+      [](T v, T) { return T(1) / (T(1) - v * v); });
+}
+
+}  // namespace htl
+
+#endif
@@ -0,0 +1,423 @@
+#ifndef HTL_DUAL_EXPR_H
+#define HTL_DUAL_EXPR_H
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "dual.hpp"
+
+namespace htl {
+
+// Optional expression templates for dual numbers. Wrapping a dual in lazy()
+// makes the operators and math functions build an expression tree instead of
+// a new dual at every step. Values and local derivatives are still computed
+// as the tree is built, as they are cheap scalars, but the tangents are only
+// computed once the expression is converted to a dual. All N tangents are
+// then found in a single loop, with no intermediate arrays:
+//
+//   htl::dual<double, 16> y = htl::lazy(a) * b + htl::sin(htl::lazy(c));
+//
+// An expression refers to the duals it was built from, so it should be
+// converted to a dual within the same statement, and not stored with auto.
+template <typename E, typename T, std::size_t N>
+struct dual_expr {
+  using value_type = T;
+  static constexpr std::size_t extent = N;
+
+  // Evaluates every tangent of the expression in one loop.
+  [[nodiscard]] constexpr operator dual<T, N>() const {
+    const E& e = static_cast<const E&>(*this);
+
+    if constexpr (N == 1) {
+      return dual<T, N>(e.value(), e.tangent(0));
+    } else {
+      auto out = [&] {
+        if constexpr (N == std::dynamic_extent) {
+          return dual<T, N>(e.value(), std::vector<T>(e.directions()));
+        } else {
+          return dual<T, N>(e.value());
+        }
+      }();
+
+      const std::span<T, N> eps = out.epsilons();
+      for (std::size_t i = 0; i < eps.size(); i++) eps[i] = e.tangent(i);
+      return out;
+    }
+  }
+
+  [[nodiscard]] constexpr dual<T, N> eval() const { return *this; }
+};
+
+namespace details {
+
+template <typename E>
+concept dual_expression =
+    std::derived_from<E, dual_expr<E, typename E::value_type, E::extent>>;
+
+// A dual which is part of an expression.
+template <typename T, std::size_t N>
+class dual_leaf : public dual_expr<dual_leaf<T, N>, T, N> {
+ public:
+  constexpr explicit dual_leaf(const dual<T, N>& d) noexcept
+      : eps_(d.epsilons()), value_(d.value()) {}
+
+  [[nodiscard]] constexpr T value() const noexcept { return value_; }
+
+  [[nodiscard]] constexpr T tangent(std::size_t i) const noexcept {
+    if constexpr (N == std::dynamic_extent) {
+      return i < eps_.size() ? eps_[i] : T(0);
+    } else {
+      return eps_[i];
+    }
+  }
+
+  [[nodiscard]] constexpr std::size_t directions() const noexcept {
+    return eps_.size();
+  }
+
+ private:
+  std::span<const T, N> eps_;
+  T value_;
+};
+
+// A function of one expression, with value f and derivative df.
+template <dual_expression A>
+class dual_unary
+    : public dual_expr<dual_unary<A>, typename A::value_type, A::extent> {
+ public:
+  using T = typename A::value_type;
+
+  constexpr dual_unary(const A& arg, T f, T df) noexcept
+      : arg_(arg), value_(f), df_(df) {}
+
+  [[nodiscard]] constexpr T value() const noexcept { return value_; }
+
+  [[nodiscard]] constexpr T tangent(std::size_t i) const noexcept {
+    return df_ * arg_.tangent(i);
+  }
+
+  [[nodiscard]] constexpr std::size_t directions() const noexcept {
+    return arg_.directions();
+  }
+
+ private:
+  A arg_;
+  T value_, df_;
+};
+
+// A function of two expressions, with value f and partial derivatives da
+// and db.
+template <dual_expression A, dual_expression B>
+requires(std::is_same_v<typename A::value_type, typename B::value_type> &&
+         A::extent == B::extent)
+class dual_binary
+    : public dual_expr<dual_binary<A, B>, typename A::value_type, A::extent> {
+ public:
+  using T = typename A::value_type;
+
+  constexpr dual_binary(const A& a, const B& b, T f, T da, T db) noexcept
+      : a_(a), b_(b), value_(f), da_(da), db_(db) {}
+
+  [[nodiscard]] constexpr T value() const noexcept { return value_; }
+
+  [[nodiscard]] constexpr T tangent(std::size_t i) const noexcept {
+    return da_ * a_.tangent(i) + db_ * b_.tangent(i);
+  }
+
+  [[nodiscard]] constexpr std::size_t directions() const noexcept {
+    return std::max(a_.directions(), b_.directions());
+  }
+
+ private:
+  A a_;
+  B b_;
+  T value_, da_, db_;
+};
+
+template <dual_expression E>
+using expr_scalar = std::type_identity_t<typename E::value_type>;
+
+template <dual_expression E>
+using expr_dual = dual<typename E::value_type, E::extent>;
+
+// Builds the node for a function of one expression, whose value and
+// derivative were found by evaluating the function on a scalar dual.
+template <dual_expression E, typename T>
+[[nodiscard]] constexpr dual_unary<E> apply(const E& e, const dual<T>& d) {
+  return dual_unary<E>(e, d.value(), d.epsilon());
+}
+
+template <dual_expression E>
+[[nodiscard]] constexpr dual<typename E::value_type> seed(const E& e) {
+  return dual<typename E::value_type>(e.value(), 1);
+}
+
+}  // namespace details
+
+// Starts an expression from a dual.
+template <typename T, std::size_t N>
+[[nodiscard]] constexpr details::dual_leaf<T, N> lazy(const dual<T, N>& d) {
+  return details::dual_leaf<T, N>(d);
+}
+
+//==========================================================
+// arithmetic between expressions
+template <details::dual_expression A, details::dual_expression B>
+[[nodiscard]] constexpr auto operator+(const A& a, const B& b) {
+  return details::dual_binary<A, B>(a, b, a.value() + b.value(), 1, 1);
+}
+
+template <details::dual_expression A, details::dual_expression B>
+[[nodiscard]] constexpr auto operator-(const A& a, const B& b) {
+  return details::dual_binary<A, B>(a, b, a.value() - b.value(), 1, -1);
+}
+
+template <details::dual_expression A, details::dual_expression B>
+[[nodiscard]] constexpr auto operator*(const A& a, const B& b) {
+  return details::dual_binary<A, B>(a, b, a.value() * b.value(), b.value(),
+                                    a.value());
+}
+
+template <details::dual_expression A, details::dual_expression B>
+[[nodiscard]] constexpr auto operator/(const A& a, const B& b) {
+  using T = typename A::value_type;
+  const T inv = T(1) / b.value();
+  const T v = a.value() * inv;
+  return details::dual_binary<A, B>(a, b, v, inv, -v * inv);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator-(const E& e) {
+  return details::dual_unary<E>(e, -e.value(), -1);
+}
+
+//==========================================================
+// arithmetic between an expression and a dual
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator+(const E& e,
+                                       const details::expr_dual<E>& d) {
+  return e + lazy(d);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator+(const details::expr_dual<E>& d,
+                                       const E& e) {
+  return lazy(d) + e;
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator-(const E& e,
+                                       const details::expr_dual<E>& d) {
+  return e - lazy(d);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator-(const details::expr_dual<E>& d,
+                                       const E& e) {
+  return lazy(d) - e;
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator*(const E& e,
+                                       const details::expr_dual<E>& d) {
+  return e * lazy(d);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator*(const details::expr_dual<E>& d,
+                                       const E& e) {
+  return lazy(d) * e;
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator/(const E& e,
+                                       const details::expr_dual<E>& d) {
+  return e / lazy(d);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator/(const details::expr_dual<E>& d,
+                                       const E& e) {
+  return lazy(d) / e;
+}
+
+//==========================================================
+// arithmetic between an expression and a scalar
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator+(const E& e, details::expr_scalar<E> s) {
+  return details::dual_unary<E>(e, e.value() + s, 1);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator+(details::expr_scalar<E> s, const E& e) {
+  return details::dual_unary<E>(e, s + e.value(), 1);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator-(const E& e, details::expr_scalar<E> s) {
+  return details::dual_unary<E>(e, e.value() - s, 1);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator-(details::expr_scalar<E> s, const E& e) {
+  return details::dual_unary<E>(e, s - e.value(), -1);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator*(const E& e, details::expr_scalar<E> s) {
+  return details::dual_unary<E>(e, e.value() * s, s);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator*(details::expr_scalar<E> s, const E& e) {
+  return details::dual_unary<E>(e, s * e.value(), s);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator/(const E& e, details::expr_scalar<E> s) {
+  using T = typename E::value_type;
+  return details::dual_unary<E>(e, e.value() / s, T(1) / s);
+}
+
+template <details::dual_expression E>
+[[nodiscard]] constexpr auto operator/(details::expr_scalar<E> s, const E& e) {
+  using T = typename E::value_type;
+  const T inv = T(1) / e.value();
+  const T v = s * inv;
+  return details::dual_unary<E>(e, v, -v * inv);
+}
+
+//==========================================================
+// functions
+template <details::dual_expression E>
+[[nodiscard]] auto abs(E e) {
+  return details::apply(e, htl::abs(details::seed(e)));
+}
+
+template <details::dual_expression E, typename U>
+[[nodiscard]] auto pow(E base, U exp) {
+  return details::apply(base, htl::pow(details::seed(base), exp));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto sqrt(E e) {
+  return details::apply(e, htl::sqrt(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto cbrt(E e) {
+  return details::apply(e, htl::cbrt(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto exp(E e) {
+  return details::apply(e, htl::exp(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto exp2(E e) {
+  return details::apply(e, htl::exp2(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto expm1(E e) {
+  return details::apply(e, htl::expm1(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto log(E e) {
+  return details::apply(e, htl::log(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto log2(E e) {
+  return details::apply(e, htl::log2(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto log10(E e) {
+  return details::apply(e, htl::log10(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto log1p(E e) {
+  return details::apply(e, htl::log1p(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto sin(E e) {
+  return details::apply(e, htl::sin(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto cos(E e) {
+  return details::apply(e, htl::cos(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto tan(E e) {
+  return details::apply(e, htl::tan(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto asin(E e) {
+  return details::apply(e, htl::asin(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto acos(E e) {
+  return details::apply(e, htl::acos(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto atan(E e) {
+  return details::apply(e, htl::atan(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto sinh(E e) {
+  return details::apply(e, htl::sinh(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto cosh(E e) {
+  return details::apply(e, htl::cosh(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto tanh(E e) {
+  return details::apply(e, htl::tanh(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto asinh(E e) {
+  return details::apply(e, htl::asinh(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto acosh(E e) {
+  return details::apply(e, htl::acosh(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto atanh(E e) {
+  return details::apply(e, htl::atanh(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto erf(E e) {
+  return details::apply(e, htl::erf(details::seed(e)));
+}
+
+template <details::dual_expression E>
+[[nodiscard]] auto erfc(E e) {
+  return details::apply(e, htl::erfc(details::seed(e)));
+}
+
+}  // namespace htl
+
+#endif
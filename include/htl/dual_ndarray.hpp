@@ -0,0 +1,57 @@
+#ifndef HTL_DUAL_NDARRAY_H
+#define HTL_DUAL_NDARRAY_H
+
+#include <concepts>
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+
+#include "dual.hpp"
+#include "ndarray.hpp"
+#include "strided_span.hpp"
+
+namespace htl {
+
+// Views of the values, and of the i'th tangents, of an array of duals. The
+// views point into the array, so writing through them updates the duals.
+template <std::floating_point T, std::size_t N, typename Allocator>
+requires(N != std::dynamic_extent)
+[[nodiscard]] strided_span<T> values(ndarray<dual<T, N>, Allocator>& arr) {
+  return strided_span<T>(reinterpret_cast<T*>(arr.data()), arr.size(), N + 1);
+}
+
+template <std::floating_point T, std::size_t N, typename Allocator>
+requires(N != std::dynamic_extent)
+[[nodiscard]] strided_span<const T> values(
+    const ndarray<dual<T, N>, Allocator>& arr) {
+  return strided_span<const T>(reinterpret_cast<const T*>(arr.data()),
+                               arr.size(), N + 1);
+}
+
+template <std::floating_point T, std::size_t N, typename Allocator>
+requires(N != std::dynamic_extent)
+[[nodiscard]] strided_span<T> epsilons(ndarray<dual<T, N>, Allocator>& arr,
+                                       std::size_t i = 0) {
+  if (i >= N) {
+    throw std::out_of_range("htl::ndarray: tangent index out of range");
+  }
+
+  return strided_span<T>(reinterpret_cast<T*>(arr.data()) + 1 + i,
+                         arr.size(), N + 1);
+}
+
+template <std::floating_point T, std::size_t N, typename Allocator>
+requires(N != std::dynamic_extent)
+[[nodiscard]] strided_span<const T> epsilons(
+    const ndarray<dual<T, N>, Allocator>& arr, std::size_t i = 0) {
+  if (i >= N) {
+    throw std::out_of_range("htl::ndarray: tangent index out of range");
+  }
+
+  return strided_span<const T>(reinterpret_cast<const T*>(arr.data()) + 1 + i,
+                               arr.size(), N + 1);
+}
+
+}  // namespace htl
+
+#endif
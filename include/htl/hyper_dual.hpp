@@ -0,0 +1,483 @@
+#ifndef HTL_HYPER_DUAL_H
+#define HTL_HYPER_DUAL_H
+
+#include <cmath>
+#include <concepts>
+
+#include "dual.hpp"
+
+namespace htl {
+
+// A hyper-dual number a + b e1 + c e2 + d e1 e2, with e1^2 = e2^2 = 0. If
+// inputs i and j are seeded with epsilon1 = 1 and epsilon2 = 1 respectively,
+// then for the result, epsilon1 and epsilon2 are the first derivatives with
+// respect to i and j, and epsilon12 is the exact second derivative with
+// respect to both. For a diagonal entry, seed both on the same input.
+template <std::floating_point T>
+class hyper_dual {
+ public:
+  using value_type = T;
+  using const_reference = const value_type&;
+
+  constexpr hyper_dual(const_reference v = value_type(),
+                       const_reference e1 = value_type(),
+                       const_reference e2 = value_type(),
+                       const_reference e12 = value_type())
+      : value_(v), epsilon1_(e1), epsilon2_(e2), epsilon12_(e12) {}
+
+  [[nodiscard]] constexpr value_type value() const { return value_; }
+  constexpr void value(value_type v) { value_ = v; }
+
+  [[nodiscard]] constexpr value_type epsilon1() const { return epsilon1_; }
+  constexpr void epsilon1(value_type e) { epsilon1_ = e; }
+
+  [[nodiscard]] constexpr value_type epsilon2() const { return epsilon2_; }
+  constexpr void epsilon2(value_type e) { epsilon2_ = e; }
+
+  [[nodiscard]] constexpr value_type epsilon12() const { return epsilon12_; }
+  constexpr void epsilon12(value_type e) { epsilon12_ = e; }
+
+  [[nodiscard]] hyper_dual operator+() const { return *this; }
+
+  [[nodiscard]] hyper_dual operator-() const {
+    return hyper_dual(-value_, -epsilon1_, -epsilon2_, -epsilon12_);
+  }
+
+  hyper_dual& operator+=(const hyper_dual& other) {
+    value_ += other.value_;
+    epsilon1_ += other.epsilon1_;
+    epsilon2_ += other.epsilon2_;
+    epsilon12_ += other.epsilon12_;
+    return *this;
+  }
+
+  hyper_dual& operator+=(const_reference v) {
+    value_ += v;
+    return *this;
+  }
+
+  hyper_dual& operator-=(const hyper_dual& other) {
+    value_ -= other.value_;
+    epsilon1_ -= other.epsilon1_;
+    epsilon2_ -= other.epsilon2_;
+    epsilon12_ -= other.epsilon12_;
+    return *this;
+  }
+
+  hyper_dual& operator-=(const_reference v) {
+    value_ -= v;
+    return *this;
+  }
+
+  hyper_dual& operator*=(const hyper_dual& other) {
+    *this = hyper_dual(value_ * other.value_,
+                       value_ * other.epsilon1_ + epsilon1_ * other.value_,
+                       value_ * other.epsilon2_ + epsilon2_ * other.value_,
+                       value_ * other.epsilon12_ + epsilon1_ * other.epsilon2_ +
+                           epsilon2_ * other.epsilon1_ +
+                           epsilon12_ * other.value_);
+    return *this;
+  }
+
+  hyper_dual& operator*=(const_reference v) {
+    value_ *= v;
+    epsilon1_ *= v;
+    epsilon2_ *= v;
+    epsilon12_ *= v;
+    return *this;
+  }
+
+  hyper_dual& operator/=(const hyper_dual& other) {
+    // Multiply by the reciprocal, whose derivatives are -1/v^2 and 2/v^3
+    const value_type inv = value_type(1) / other.value_;
+    const value_type d_inv = -inv * inv;
+    hyper_dual recip(inv, d_inv * other.epsilon1_, d_inv * other.epsilon2_,
+                     d_inv * other.epsilon12_ - value_type(2) * d_inv * inv *
+                                                    other.epsilon1_ *
+                                                    other.epsilon2_);
+    return *this *= recip;
+  }
+
+  hyper_dual& operator/=(const_reference v) {
+    value_ /= v;
+    epsilon1_ /= v;
+    epsilon2_ /= v;
+    epsilon12_ /= v;
+    return *this;
+  }
+
+  [[nodiscard]] hyper_dual operator+(const hyper_dual& other) const {
+    hyper_dual out = *this;
+    out += other;
+    return out;
+  }
+
+  [[nodiscard]] hyper_dual operator+(const_reference v) const {
+    hyper_dual out = *this;
+    out += v;
+    return out;
+  }
+
+  [[nodiscard]] hyper_dual operator-(const hyper_dual& other) const {
+    hyper_dual out = *this;
+    out -= other;
+    return out;
+  }
+
+  [[nodiscard]] hyper_dual operator-(const_reference v) const {
+    hyper_dual out = *this;
+    out -= v;
+    return out;
+  }
+
+  [[nodiscard]] hyper_dual operator*(const hyper_dual& other) const {
+    hyper_dual out = *this;
+    out *= other;
+    return out;
+  }
+
+  [[nodiscard]] hyper_dual operator*(const_reference v) const {
+    hyper_dual out = *this;
+    out *= v;
+    return out;
+  }
+
+  [[nodiscard]] hyper_dual operator/(const hyper_dual& other) const {
+    hyper_dual out = *this;
+    out /= other;
+    return out;
+  }
+
+  [[nodiscard]] hyper_dual operator/(const_reference v) const {
+    hyper_dual out = *this;
+    out /= v;
+    return out;
+  }
+
+  [[nodiscard]] friend hyper_dual operator+(const_reference v,
+                                            const hyper_dual& h) {
+    return h + v;
+  }
+
+  [[nodiscard]] friend hyper_dual operator-(const_reference v,
+                                            const hyper_dual& h) {
+    hyper_dual out = -h;
+    out += v;
+    return out;
+  }
+
+  [[nodiscard]] friend hyper_dual operator*(const_reference v,
+                                            const hyper_dual& h) {
+    return h * v;
+  }
+
+  [[nodiscard]] friend hyper_dual operator/(const_reference v,
+                                            const hyper_dual& h) {
+    hyper_dual out(v);
+    out /= h;
+    return out;
+  }
+
+ private:
+  value_type value_, epsilon1_, epsilon2_, epsilon12_;
+};
+
+namespace details {
+
+// Applies the chain rule to a function of one variable, given its value f,
+// and its first and second derivatives df and d2f, at arg.value().
+template <typename T>
+[[nodiscard]] constexpr hyper_dual<T> chain2(const hyper_dual<T>& arg, T f,
+                                             T df, T d2f) {
+  return hyper_dual<T>(
+      f, df * arg.epsilon1(), df * arg.epsilon2(),
+      df * arg.epsilon12() + d2f * arg.epsilon1() * arg.epsilon2());
+}
+
+// Applies the chain rule to a function of two variables, given its value f,
+// its gradient (fa, fb) and its Hessian (faa, fab, fbb) at the values of a
+// and b.
+template <typename T>
+[[nodiscard]] constexpr hyper_dual<T> chain2(const hyper_dual<T>& a,
+                                             const hyper_dual<T>& b, T f,
+                                             T fa, T fb, T faa, T fab,
+                                             T fbb) {
+  return hyper_dual<T>(
+      f, fa * a.epsilon1() + fb * b.epsilon1(),
+      fa * a.epsilon2() + fb * b.epsilon2(),
+      fa * a.epsilon12() + fb * b.epsilon12() +
+          faa * a.epsilon1() * a.epsilon2() +
+          fab * (a.epsilon1() * b.epsilon2() + a.epsilon2() * b.epsilon1()) +
+          fbb * b.epsilon1() * b.epsilon2());
+}
+
+}  // namespace details
+
+//==========================================================
+// abs
+template <typename T>
+[[nodiscard]] hyper_dual<T> abs(hyper_dual<T> arg) {
+  const T v = arg.value();
+  return details::chain2(arg, std::abs(v), v >= T(0) ? T(1) : T(-1), T(0));
+}
+
+//==========================================================
+// pow
+template <typename T1, typename T2>
+[[nodiscard]] hyper_dual<T1> pow(hyper_dual<T1> base, T2 exp) {
+  const T1 v = base.value();
+  const T1 p = static_cast<T1>(exp);
+  return details::chain2(base, T1(std::pow(v, p)), p * std::pow(v, p - T1(1)),
+                         p * (p - T1(1)) * std::pow(v, p - T1(2)));
+}
+
+template <typename T1, typename T2>
+[[nodiscard]] hyper_dual<T2> pow(T1 base, hyper_dual<T2> exp) {
+  const T2 out_val = std::pow(base, exp.value());
+  const T2 log_base = std::log(static_cast<T2>(base));
+  return details::chain2(exp, out_val, out_val * log_base,
+                         out_val * log_base * log_base);
+}
+
+template <typename T>
+[[nodiscard]] hyper_dual<T> pow(const hyper_dual<T>& base,
+                               const hyper_dual<T>& exp) {
+  const T v = base.value();
+  const T p = exp.value();
+  const T f = std::pow(v, p);
+  const T log_v = std::log(v);
+
+  // As for dual, the derivatives reuse f, except at a zero base
+  const T f_v = v != T(0) ? f / v : std::pow(v, p - T(1));
+  const T f_vv = v != T(0) ? f_v / v : std::pow(v, p - T(2));
+  return details::chain2(base, exp, f, p * f_v, f * log_v,
+                         p * (p - T(1)) * f_vv, f_v * (T(1) + p * log_v),
+                         f * log_v * log_v);
+}
+
+//==========================================================
+// sqrt
+template <typename T>
+[[nodiscard]] hyper_dual<T> sqrt(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T sqrt_value = std::sqrt(v);
+  const T df = T(0.5) / sqrt_value;
+  return details::chain2(arg, sqrt_value, df, -T(0.5) * df / v);
+}
+
+//==========================================================
+// cbrt
+template <typename T>
+[[nodiscard]] hyper_dual<T> cbrt(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T cbrt_value = std::cbrt(v);
+  const T df = T(1) / (T(3) * cbrt_value * cbrt_value);
+  return details::chain2(arg, cbrt_value, df, -T(2) * df / (T(3) * v));
+}
+
+//==========================================================
+// exp
+template <typename T>
+[[nodiscard]] hyper_dual<T> exp(hyper_dual<T> arg) {
+  const T exp_value = std::exp(arg.value());
+  return details::chain2(arg, exp_value, exp_value, exp_value);
+}
+
+//==========================================================
+// exp2
+template <typename T>
+[[nodiscard]] hyper_dual<T> exp2(hyper_dual<T> arg) {
+  const T exp2_value = std::exp2(arg.value());
+  const T ln2 = std::log(T(2));
+  return details::chain2(arg, exp2_value, exp2_value * ln2,
+                         exp2_value * ln2 * ln2);
+}
+
+//==========================================================
+// expm1
+template <typename T>
+[[nodiscard]] hyper_dual<T> expm1(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T exp_value = std::exp(v);
+  return details::chain2(arg, std::expm1(v), exp_value, exp_value);
+}
+
+//==========================================================
+// log
+template <typename T>
+[[nodiscard]] hyper_dual<T> log(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / v;
+  return details::chain2(arg, std::log(v), df, -df * df);
+}
+
+//==========================================================
+// log2
+template <typename T>
+[[nodiscard]] hyper_dual<T> log2(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / (v * std::log(T(2)));
+  return details::chain2(arg, std::log2(v), df, -df / v);
+}
+
+//==========================================================
+// log10
+template <typename T>
+[[nodiscard]] hyper_dual<T> log10(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / (v * std::log(T(10)));
+  return details::chain2(arg, std::log10(v), df, -df / v);
+}
+
+//==========================================================
+// log1p
+template <typename T>
+[[nodiscard]] hyper_dual<T> log1p(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / (T(1) + v);
+  return details::chain2(arg, std::log1p(v), df, -df * df);
+}
+
+//==========================================================
+// sin
+template <typename T>
+[[nodiscard]] hyper_dual<T> sin(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T sin_val = std::sin(v);
+  return details::chain2(arg, sin_val, std::cos(v), -sin_val);
+}
+
+//==========================================================
+// cos
+template <typename T>
+[[nodiscard]] hyper_dual<T> cos(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T cos_val = std::cos(v);
+  return details::chain2(arg, cos_val, -std::sin(v), -cos_val);
+}
+
+//==========================================================
+// tan
+template <typename T>
+[[nodiscard]] hyper_dual<T> tan(hyper_dual<T> arg) {
+  const T tan_val = std::tan(arg.value());
+  const T df = T(1) + tan_val * tan_val;
+  return details::chain2(arg, tan_val, df, T(2) * tan_val * df);
+}
+
+//==========================================================
+// asin
+template <typename T>
+[[nodiscard]] hyper_dual<T> asin(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / std::sqrt(T(1) - v * v);
+  return details::chain2(arg, std::asin(v), df, v * df * df * df);
+}
+
+//==========================================================
+// acos
+template <typename T>
+[[nodiscard]] hyper_dual<T> acos(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / std::sqrt(T(1) - v * v);
+  return details::chain2(arg, std::acos(v), -df, -v * df * df * df);
+}
+
+//==========================================================
+// atan
+template <typename T>
+[[nodiscard]] hyper_dual<T> atan(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / (T(1) + v * v);
+  return details::chain2(arg, std::atan(v), df, -T(2) * v * df * df);
+}
+
+//==========================================================
+// atan2
+template <typename T1, typename T2>
+[[nodiscard]] hyper_dual<T1> atan2(hyper_dual<T1> y, T2 x) {
+  const T1 v = y.value();
+  const T1 xv = static_cast<T1>(x);
+  const T1 inv = T1(1) / (xv * xv + v * v);
+  return details::chain2(y, T1(std::atan2(v, xv)), xv * inv,
+                         -T1(2) * xv * v * inv * inv);
+}
+
+template <typename T1, typename T2>
+[[nodiscard]] hyper_dual<T2> atan2(T1 y, hyper_dual<T2> x) {
+  const T2 v = x.value();
+  const T2 yv = static_cast<T2>(y);
+  const T2 inv = T2(1) / (v * v + yv * yv);
+  return details::chain2(x, T2(std::atan2(yv, v)), -yv * inv,
+                         T2(2) * yv * v * inv * inv);
+}
+
+template <typename T>
+[[nodiscard]] hyper_dual<T> atan2(const hyper_dual<T>& y,
+                                 const hyper_dual<T>& x) {
+  const T yv = y.value();
+  const T xv = x.value();
+  const T inv = T(1) / (xv * xv + yv * yv);
+  const T inv2 = inv * inv;
+  return details::chain2(y, x, T(std::atan2(yv, xv)), xv * inv, -yv * inv,
+                         -T(2) * xv * yv * inv2, (yv * yv - xv * xv) * inv2,
+                         T(2) * xv * yv * inv2);
+}
+
+//==========================================================
+// sinh
+template <typename T>
+[[nodiscard]] hyper_dual<T> sinh(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T sinh_val = std::sinh(v);
+  return details::chain2(arg, sinh_val, std::cosh(v), sinh_val);
+}
+
+//==========================================================
+// cosh
+template <typename T>
+[[nodiscard]] hyper_dual<T> cosh(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T cosh_val = std::cosh(v);
+  return details::chain2(arg, cosh_val, std::sinh(v), cosh_val);
+}
+
+//==========================================================
+// tanh
+template <typename T>
+[[nodiscard]] hyper_dual<T> tanh(hyper_dual<T> arg) {
+  const T tanh_val = std::tanh(arg.value());
+  const T df = T(1) - tanh_val * tanh_val;
+  return details::chain2(arg, tanh_val, df, -T(2) * tanh_val * df);
+}
+
+//==========================================================
+// asinh
+template <typename T>
+[[nodiscard]] hyper_dual<T> asinh(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / std::sqrt(T(1) + v * v);
+  return details::chain2(arg, std::asinh(v), df, -v * df * df * df);
+}
+
+//==========================================================
+// acosh
+template <typename T>
+[[nodiscard]] hyper_dual<T> acosh(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / std::sqrt(v * v - T(1));
+  return details::chain2(arg, std::acosh(v), df, -v * df * df * df);
+}
+
+//==========================================================
+// atanh
+template <typename T>
+[[nodiscard]] hyper_dual<T> atanh(hyper_dual<T> arg) {
+  const T v = arg.value();
+  const T df = T(1) / (T(1) - v * v);
+  return details::chain2(arg, std::atanh(v), df, T(2) * v * df * df);
+}
+
+}  // namespace htl
+
+#endif
@@ -0,0 +1,162 @@
+#ifndef HTL_JACOBIAN_H
+#define HTL_JACOBIAN_H
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "dual.hpp"
+#include "ndarray.hpp"
+
+namespace htl {
+
+namespace details {
+
+// Evaluates f once per pass, for passes [first, last), spread over the given
+// number of threads (0 for one per core). Before each pass, seed(p, x, 1)
+// sets the tangents of the inputs, and afterwards seed(p, x, 0) clears them
+// again, so that each thread reuses a single copy of the inputs. The outputs
+// of pass p are handed to store(p, y). Passes run concurrently, so f must be
+// safe to call from several threads, and store must only write to locations
+// owned by pass p. The first exception thrown stops the sweep, and is
+// rethrown once every thread has finished.
+template <std::size_t N, std::floating_point T, typename F, typename Seed,
+          typename Store>
+void sweep(const F& f, std::span<const T> x, std::size_t first,
+           std::size_t last, std::size_t threads, const Seed& seed,
+           const Store& store) {
+  if (first >= last) return;
+
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  threads = std::clamp<std::size_t>(threads, 1, last - first);
+
+  std::atomic<std::size_t> next(first);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  auto work = [&] {
+    try {
+      std::vector<dual<T, N>> xd(x.begin(), x.end());
+
+      for (std::size_t p; (p = next++) < last;) {
+        seed(p, std::span<dual<T, N>>(xd), T(1));
+        store(p, f(std::as_const(xd)));
+        seed(p, std::span<dual<T, N>>(xd), T(0));
+      }
+    } catch (...) {
+      std::lock_guard lock(error_mutex);
+      if (!error) error = std::current_exception();
+      next = last;
+    }
+  };
+
+  {
+    std::vector<std::jthread> pool;
+    pool.reserve(threads - 1);
+    for (std::size_t t = 1; t < threads; t++) pool.emplace_back(work);
+    work();
+  }
+
+  if (error) std::rethrow_exception(error);
+}
+
+// Pass p of a dense sweep seeds the inputs [p * N, p * N + N).
+template <std::size_t N>
+struct dense_seed {
+  template <std::floating_point T>
+  void operator()(std::size_t p, std::span<dual<T, N>> x, T v) const {
+    const std::size_t begin = p * N;
+    const std::size_t end = std::min(begin + N, x.size());
+    for (std::size_t i = begin; i < end; i++) x[i].epsilon(i - begin, v);
+  }
+};
+
+template <std::size_t N>
+[[nodiscard]] constexpr std::size_t passes(std::size_t n) {
+  return (n + N - 1) / N;
+}
+
+template <typename R>
+concept input_range =
+    std::ranges::contiguous_range<R> && std::ranges::sized_range<R> &&
+    std::floating_point<std::ranges::range_value_t<R>>;
+
+}  // namespace details
+
+// Returns the gradient of the scalar function f at x, using forward mode
+// with N tangents per pass. f is called with a const
+// std::vector<htl::dual<T, N>>& and must return an htl::dual<T, N>, so it is
+// usually a generic lambda. The ceil(n / N) passes are run on the given
+// number of threads, 0 for one per core.
+template <std::size_t N = 8, typename F, details::input_range R>
+requires(N != std::dynamic_extent && N > 0)
+[[nodiscard]] auto gradient(const F& f, const R& x, std::size_t threads = 0) {
+  using T = std::ranges::range_value_t<R>;
+  const std::span<const T> xs(std::ranges::data(x), std::ranges::size(x));
+
+  ndarray<T> out({xs.size()});
+  details::sweep<N>(
+      f, xs, 0, details::passes<N>(xs.size()), threads,
+      details::dense_seed<N>(), [&](std::size_t p, const dual<T, N>& y) {
+        const std::size_t begin = p * N;
+        const std::size_t end = std::min(begin + N, xs.size());
+        for (std::size_t i = begin; i < end; i++)
+          out[i] = y.epsilons()[i - begin];
+      });
+
+  return out;
+}
+
+// Returns the m by n Jacobian of f at x, where f maps n inputs to m outputs.
+// f is called as for gradient, and must return a sized range of
+// htl::dual<T, N>, such as a std::vector. Row r of the result holds the
+// derivatives of output r. The first pass runs alone to find m, and the
+// rest are spread over the threads.
+template <std::size_t N = 8, typename F, details::input_range R>
+requires(N != std::dynamic_extent && N > 0)
+[[nodiscard]] auto jacobian(const F& f, const R& x, std::size_t threads = 0) {
+  using T = std::ranges::range_value_t<R>;
+  const std::span<const T> xs(std::ranges::data(x), std::ranges::size(x));
+  const std::size_t n = xs.size();
+
+  ndarray<T> out;
+  auto store = [&](std::size_t p, const auto& y) {
+    const std::size_t begin = p * N;
+    const std::size_t end = std::min(begin + N, n);
+    if (std::ranges::size(y) != out.shape()[0]) {
+      throw std::runtime_error(
+          "htl::jacobian: number of outputs changed between passes");
+    }
+
+    std::size_t r = 0;
+    for (const dual<T, N>& yr : y) {
+      for (std::size_t i = begin; i < end; i++)
+        out[r * n + i] = yr.epsilons()[i - begin];
+      r++;
+    }
+  };
+
+  details::sweep<N>(
+      f, xs, 0, std::min<std::size_t>(1, details::passes<N>(n)), 1,
+      details::dense_seed<N>(), [&](std::size_t p, const auto& y) {
+        out.reallocate({std::ranges::size(y), n});
+        store(p, y);
+      });
+  details::sweep<N>(f, xs, 1, details::passes<N>(n), threads,
+                    details::dense_seed<N>(), store);
+
+  return out;
+}
+
+}  // namespace htl
+
+#endif
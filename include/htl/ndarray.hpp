@@ -4,18 +4,27 @@
 #include <algorithm>
 #include <array>
 #include <complex>
+#include <initializer_list>
+#include <memory>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 #include "details/npy.hpp"
+#include "details/npy_element.hpp"
 
 namespace htl {
 
-template <typename T>
+// The Allocator is used for both the elements and the shape of the array. By
+// using an htl::arena_allocator, an ndarray can be built without touching the
+// heap, and is released all at once when the arena is cleared.
+template <typename T, typename Allocator = std::allocator<T>>
 class ndarray {
  public:
   using value_type = T;
+  using allocator_type = Allocator;
   using size_type = std::size_t;
   using difference_type = std::ptrdiff_t;
   using reference = value_type&;
@@ -26,34 +35,34 @@ class ndarray {
   using const_iterator = const_pointer;
   using reverse_iterator = std::reverse_iterator<iterator>;
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+  using shape_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<size_type>;
+  using shape_type = std::vector<size_type, shape_allocator_type>;
 
   ndarray() : data_(), shape_(), c_continuous_(true), dimensions_(0) {}
 
-  ndarray(std::vector<size_type> init_shape, bool c_continuous = true)
-      : data_(), shape_(), c_continuous_(true) {
-    if (init_shape.size() > 0) {
-      shape_ = init_shape;
-      dimensions_ = shape_.size();
-
-      size_type ne = init_shape[0];
-      for (size_type i = 1; i < dimensions_; i++) {
-        ne *= init_shape[i];
-      }
+  explicit ndarray(const allocator_type& alloc)
+      : data_(alloc), shape_(alloc), c_continuous_(true), dimensions_(0) {}
 
-      data_.resize(ne);
+  ndarray(const std::vector<size_type>& init_shape, bool c_continuous = true,
+          const allocator_type& alloc = allocator_type())
+      : data_(alloc), shape_(alloc), c_continuous_(true) {
+    init(init_shape.begin(), init_shape.end(), c_continuous);
+  }
 
-      c_continuous_ = c_continuous;
-    } else {
-      throw std::runtime_error(
-          "htl::ndarray shape vector must have at least one element");
-    }
+  ndarray(std::initializer_list<size_type> init_shape,
+          bool c_continuous = true,
+          const allocator_type& alloc = allocator_type())
+      : data_(alloc), shape_(alloc), c_continuous_(true) {
+    init(init_shape.begin(), init_shape.end(), c_continuous);
   }
 
   ndarray(std::vector<value_type> data, std::vector<size_type> init_shape,
-          bool c_continuous = true)
-      : data_(), shape_(), c_continuous_(true) {
+          bool c_continuous = true,
+          const allocator_type& alloc = allocator_type())
+      : data_(alloc), shape_(alloc), c_continuous_(true) {
     if (init_shape.size() > 0) {
-      shape_ = init_shape;
+      shape_.assign(init_shape.begin(), init_shape.end());
       dimensions_ = shape_.size();
 
       size_type ne = init_shape[0];
@@ -66,7 +75,11 @@ class ndarray {
             "htl::ndarray: shape is incompatible with number of elements");
       }
 
-      data_ = data;
+      if constexpr (std::is_same_v<decltype(data), decltype(data_)>) {
+        data_ = std::move(data);
+      } else {
+        data_.assign(data.begin(), data.end());
+      }
 
       c_continuous_ = c_continuous;
     } else {
@@ -143,7 +156,11 @@ class ndarray {
 
   [[nodiscard]] const_reference operator[](size_type i) const { return data_[i]; }
 
-  [[nodiscard]] std::vector<size_type> shape() const { return shape_; }
+  [[nodiscard]] pointer data() noexcept { return data_.data(); }
+
+  [[nodiscard]] const_pointer data() const noexcept { return data_.data(); }
+
+  [[nodiscard]] const shape_type& shape() const { return shape_; }
 
   [[nodiscard]] size_type size() const { return data_.size(); }
 
@@ -162,12 +179,19 @@ class ndarray {
 
   [[nodiscard]] bool c_continuous() const { return c_continuous_; }
 
-  [[nodiscard]] static ndarray load(const std::string& fname) {
+  [[nodiscard]] allocator_type get_allocator() const {
+    return data_.get_allocator();
+  }
+
+  [[nodiscard]] static ndarray load(
+      const std::string& fname,
+      const allocator_type& alloc = allocator_type()) {
     using namespace details;
 
     // Get expected DType according to T
     DType expected_dtype;
-    const char* T_type_name = typeid(value_type).name();
+    const char* T_type_name =
+        typeid(typename npy_element<value_type>::type).name();
 
     if (T_type_name == typeid(char).name())
       expected_dtype = DType::CHAR;
@@ -215,6 +239,19 @@ class ndarray {
           "in npy file");
     }
 
+    // Remove the axis holding the components of each element
+    constexpr size_type components = npy_element<value_type>::components;
+    if constexpr (components > 1) {
+      const size_type axis = data_c_continuous ? data_shape.size() - 1 : 0;
+      if (data_shape.size() < 2 || data_shape[axis] != components) {
+        delete[] data_ptr;
+        throw std::runtime_error(
+            "htl::ndarray: npy file does not have an axis of " +
+            std::to_string(components) + " components per element");
+      }
+      data_shape.erase(data_shape.begin() + axis);
+    }
+
     if (data_shape.size() < 1) {
       throw std::runtime_error(
           "htl::ndarray: shape vector must have at least one element");
@@ -230,7 +267,7 @@ class ndarray {
                    reinterpret_cast<pointer>(data_ptr) + ne};
 
     // Create ndarray object
-    ndarray<value_type> return_object(data_vector, data_shape);
+    ndarray return_object(std::move(data_vector), data_shape, true, alloc);
     return_object.c_continuous_ = data_c_continuous;
 
     // Free data_ptr
@@ -245,7 +282,8 @@ class ndarray {
 
     // Get expected DType according to T
     DType dtype;
-    const char* T_type_name = typeid(value_type).name();
+    const char* T_type_name =
+        typeid(typename npy_element<value_type>::type).name();
 
     if (T_type_name == typeid(char).name())
       dtype = DType::CHAR;
@@ -273,17 +311,34 @@ class ndarray {
       dtype = DType::COMPLEX128;
     else {
       throw std::runtime_error(
-          "htl::ndarray: shape vector must have at least one element");
+          "htl::ndarray: the datatype is not supported by the npy format");
+    }
+
+    // Components of an element are the fastest varying axis: the last one in
+    // C order, and the first one in Fortran order
+    std::vector<size_type> file_shape(shape_.begin(), shape_.end());
+    constexpr size_type components = npy_element<value_type>::components;
+    if constexpr (components > 1) {
+      file_shape.insert(c_continuous_ ? file_shape.end() : file_shape.begin(),
+                        components);
     }
 
     // Write data to file
-    write_npy(fname, reinterpret_cast<const char*>(data_.data()), shape_, dtype,
-              c_continuous_);
+    write_npy(fname, reinterpret_cast<const char*>(data_.data()), file_shape,
+              dtype, c_continuous_);
   }
 
   void fill(const_reference val) { std::fill(data_.begin(), data_.end(), val); }
 
-  void reshape(std::vector<size_type> new_shape) {
+  void reshape(const std::vector<size_type>& new_shape) {
+    reshape(std::span<const size_type>(new_shape));
+  }
+
+  void reshape(std::initializer_list<size_type> new_shape) {
+    reshape(std::span<const size_type>(new_shape.begin(), new_shape.size()));
+  }
+
+  void reshape(std::span<const size_type> new_shape) {
     // Ensure new shape has proper dimensions
     if (new_shape.size() < 1) {
       throw std::runtime_error(
@@ -297,7 +352,7 @@ class ndarray {
       }
 
       if (ne == data_.size()) {
-        shape_ = new_shape;
+        shape_.assign(new_shape.begin(), new_shape.end());
         dimensions_ = shape_.size();
       } else {
         throw std::runtime_error(
@@ -306,7 +361,16 @@ class ndarray {
     }
   }
 
-  void reallocate(std::vector<size_type> new_shape) {
+  void reallocate(const std::vector<size_type>& new_shape) {
+    reallocate(std::span<const size_type>(new_shape));
+  }
+
+  void reallocate(std::initializer_list<size_type> new_shape) {
+    reallocate(
+        std::span<const size_type>(new_shape.begin(), new_shape.size()));
+  }
+
+  void reallocate(std::span<const size_type> new_shape) {
     // Ensure new shape has proper dimensions
     if (new_shape.size() < 1) {
       throw std::runtime_error(
@@ -319,7 +383,7 @@ class ndarray {
         ne *= new_shape[i];
       }
 
-      shape_ = new_shape;
+      shape_.assign(new_shape.begin(), new_shape.end());
       dimensions_ = shape_.size();
       data_.resize(ne);
     }
@@ -368,11 +432,31 @@ class ndarray {
   }
 
  private:
-  std::vector<value_type> data_;
-  std::vector<size_type> shape_;
+  std::vector<value_type, allocator_type> data_;
+  shape_type shape_;
   bool c_continuous_;
   size_type dimensions_;
 
+  template <class It>
+  void init(It shape_begin, It shape_end, bool c_continuous) {
+    if (shape_begin == shape_end) {
+      throw std::runtime_error(
+          "htl::ndarray shape vector must have at least one element");
+    }
+
+    shape_.assign(shape_begin, shape_end);
+    dimensions_ = shape_.size();
+
+    size_type ne = shape_[0];
+    for (size_type i = 1; i < dimensions_; i++) {
+      ne *= shape_[i];
+    }
+
+    data_.resize(ne);
+
+    c_continuous_ = c_continuous;
+  }
+
   template <class V>
   [[nodiscard]] size_type at_c_continuous_index(const V& indices) const {
     // Make sure proper number of indices
@@ -0,0 +1,150 @@
+#ifndef HTL_OBJECT_POOL_H
+#define HTL_OBJECT_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <span>
+#include <utility>
+
+#include "arena.hpp"
+
+namespace htl {
+
+// A pool of fixed size slots for objects of type T, carved out of a single
+// arena block. Freed slots are kept on an intrusive free list, so that both
+// allocate and free are O(1). Like the arenas, a pool is not thread safe;
+// each thread should own its own pool.
+template <typename T>
+class object_pool {
+ public:
+  using value_type = T;
+  using size_type = std::size_t;
+  using pointer = T*;
+
+  object_pool(size_type capacity = 0)
+      : arena_(capacity > 0 ? capacity * SLOT_STRIDE + SLOT_ALIGN : 0),
+        free_list_(nullptr),
+        capacity_(capacity),
+        carved_(0) {}
+
+  object_pool(object_pool&& other)
+      : arena_(std::move(other.arena_)),
+        free_list_(std::exchange(other.free_list_, nullptr)),
+        capacity_(std::exchange(other.capacity_, 0)),
+        carved_(std::exchange(other.carved_, 0)) {}
+
+  object_pool& operator=(object_pool&& other) {
+    if (this != &other) {
+      arena_ = std::move(other.arena_);
+      free_list_ = std::exchange(other.free_list_, nullptr);
+      capacity_ = std::exchange(other.capacity_, 0);
+      carved_ = std::exchange(other.carved_, 0);
+    }
+
+    return *this;
+  }
+
+  // Slots are handed out as raw pointers, so a pool may not be copied.
+  object_pool(const object_pool& other) = delete;
+  object_pool& operator=(const object_pool& other) = delete;
+
+  // Returns uninitialized storage for one T, or nullptr if the pool is
+  // exhausted.
+  [[nodiscard]] pointer allocate() {
+    if (free_list_ != nullptr) {
+      slot* s = free_list_;
+      free_list_ = s->next;
+      return reinterpret_cast<pointer>(s);
+    }
+
+    // Carve a new slot from the arena. The arena has some extra room for
+    // alignment, so the slot count is checked explicitly.
+    if (carved_ == capacity_) {
+      return nullptr;
+    }
+
+    carved_++;
+    return reinterpret_cast<pointer>(arena_.malloc(SLOT_SIZE, SLOT_ALIGN));
+  }
+
+  // Fills out with pointers to uninitialized slots. The number of slots
+  // obtained is returned, which is less than out.size() if the pool runs out.
+  size_type allocate(std::span<pointer> out) {
+    size_type n = 0;
+
+    for (; n < out.size(); n++) {
+      out[n] = allocate();
+      if (out[n] == nullptr) break;
+    }
+
+    return n;
+  }
+
+  // Returns a slot to the pool. The object in it must already be destroyed.
+  void free(pointer ptr) {
+    free_list_ = new (static_cast<void*>(ptr)) slot{free_list_};
+  }
+
+  void free(std::span<const pointer> ptrs) {
+    for (pointer ptr : ptrs) free(ptr);
+  }
+
+  template <typename... Types>
+  [[nodiscard]] pointer make(Types&&... args) {
+    pointer out = allocate();
+
+    if (out == nullptr) {
+      return nullptr;
+    }
+
+    try {
+      new (out) T(std::forward<Types>(args)...);
+    } catch (...) {
+      free(out);
+      throw;
+    }
+
+    return out;
+  }
+
+  void destroy(pointer ptr) {
+    ptr->~T();
+    free(ptr);
+  }
+
+  size_type capacity() const { return capacity_; }
+
+  // Returns every slot to the pool at once. Objects still living in the pool
+  // are not destroyed.
+  void clear() {
+    free_list_ = nullptr;
+    carved_ = 0;
+    arena_.clear();
+  }
+
+ private:
+  struct slot {
+    slot* next;
+  };
+
+  static constexpr size_type SLOT_ALIGN =
+      alignof(T) > alignof(slot) ? alignof(T) : alignof(slot);
+  static constexpr size_type SLOT_SIZE =
+      ((sizeof(T) > sizeof(slot) ? sizeof(T) : sizeof(slot)) + SLOT_ALIGN -
+       1) /
+      SLOT_ALIGN * SLOT_ALIGN;
+  // Distance between slots in the arena, which includes the red zone placed
+  // after each allocation in debug builds.
+  static constexpr size_type SLOT_STRIDE =
+      (SLOT_SIZE + details::ARENA_RED_ZONE + SLOT_ALIGN - 1) / SLOT_ALIGN *
+      SLOT_ALIGN;
+
+  arena arena_;
+  slot* free_list_;
+  size_type capacity_;
+  size_type carved_;  // Number of slots taken from the arena so far
+};
+
+}  // namespace htl
+
+#endif
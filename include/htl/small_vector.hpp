@@ -0,0 +1,517 @@
+#ifndef HTL_SMALL_VECTOR_H
+#define HTL_SMALL_VECTOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "static_vector.hpp"
+
+namespace htl {
+
+// A vector which keeps up to N elements inline, in a static_vector, and only
+// moves them to memory obtained from Allocator once it grows past N. Any
+// allocator may be used, including htl::arena_allocator. Once spilled, the
+// elements stay on the heap until shrink_to_fit is called, so that repeated
+// growth does not bounce between the two.
+template <class T, std::size_t N, class Allocator = std::allocator<T>>
+class small_vector {
+ public:
+  using value_type = T;
+  using allocator_type = Allocator;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = value_type&;
+  using const_reference = const value_type&;
+  using pointer = T*;
+  using const_pointer = const T*;
+  using iterator = pointer;
+  using const_iterator = const_pointer;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+  constexpr small_vector() noexcept(noexcept(allocator_type()))
+      : inline_(), alloc_(), heap_(nullptr), size_(0), capacity_(0) {}
+
+  constexpr explicit small_vector(const allocator_type& alloc) noexcept
+      : inline_(), alloc_(alloc), heap_(nullptr), size_(0), capacity_(0) {}
+
+  constexpr small_vector(size_type count, const_reference value,
+                         const allocator_type& alloc = allocator_type())
+      : small_vector(alloc) {
+    resize(count, value);
+  }
+
+  constexpr explicit small_vector(
+      size_type count, const allocator_type& alloc = allocator_type())
+      : small_vector(alloc) {
+    resize(count);
+  }
+
+  template <std::input_iterator InputIt>
+  constexpr small_vector(InputIt first, InputIt last,
+                         const allocator_type& alloc = allocator_type())
+      : small_vector(alloc) {
+    insert(end(), first, last);
+  }
+
+  constexpr small_vector(std::initializer_list<value_type> init,
+                         const allocator_type& alloc = allocator_type())
+      : small_vector(alloc) {
+    insert(end(), init.begin(), init.end());
+  }
+
+  constexpr small_vector(const small_vector& other)
+      : small_vector(alloc_traits::select_on_container_copy_construction(
+            other.alloc_)) {
+    insert(end(), other.begin(), other.end());
+  }
+
+  constexpr small_vector(small_vector&& other) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>)
+      : inline_(std::move(other.inline_)),
+        alloc_(std::move(other.alloc_)),
+        heap_(std::exchange(other.heap_, nullptr)),
+        size_(std::exchange(other.size_, 0)),
+        capacity_(std::exchange(other.capacity_, 0)) {}
+
+  constexpr small_vector& operator=(const small_vector& other) {
+    if (this != &other) {
+      clear();
+      insert(end(), other.begin(), other.end());
+    }
+
+    return *this;
+  }
+
+  constexpr small_vector& operator=(small_vector&& other) noexcept(
+      std::is_nothrow_move_constructible_v<value_type> &&
+      (alloc_traits::propagate_on_container_move_assignment::value ||
+       alloc_traits::is_always_equal::value)) {
+    if (this == &other) return *this;
+
+    if (other.heap_ != nullptr &&
+        (alloc_traits::propagate_on_container_move_assignment::value ||
+         alloc_ == other.alloc_)) {
+      // The heap block can simply change hands
+      release();
+      if constexpr (alloc_traits::propagate_on_container_move_assignment::
+                        value) {
+        alloc_ = std::move(other.alloc_);
+      }
+      heap_ = std::exchange(other.heap_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+      capacity_ = std::exchange(other.capacity_, 0);
+    } else {
+      clear();
+      insert(end(), std::make_move_iterator(other.begin()),
+             std::make_move_iterator(other.end()));
+      other.clear();
+    }
+
+    return *this;
+  }
+
+  constexpr small_vector& operator=(std::initializer_list<value_type> init) {
+    clear();
+    insert(end(), init.begin(), init.end());
+
+    return *this;
+  }
+
+  constexpr ~small_vector() { release(); }
+
+  [[nodiscard]] constexpr reference at(size_type i) {
+    check_index(i);
+
+    return data()[i];
+  }
+
+  [[nodiscard]] constexpr const_reference at(size_type i) const {
+    check_index(i);
+
+    return data()[i];
+  }
+
+  [[nodiscard]] constexpr reference operator[](size_type i) {
+    return data()[i];
+  }
+
+  [[nodiscard]] constexpr const_reference operator[](size_type i) const {
+    return data()[i];
+  }
+
+  [[nodiscard]] constexpr reference front() { return data()[0]; }
+
+  [[nodiscard]] constexpr const_reference front() const { return data()[0]; }
+
+  [[nodiscard]] constexpr reference back() { return data()[size() - 1]; }
+
+  [[nodiscard]] constexpr const_reference back() const {
+    return data()[size() - 1];
+  }
+
+  [[nodiscard]] constexpr pointer data() noexcept {
+    return heap_ ? heap_ : inline_.data();
+  }
+
+  [[nodiscard]] constexpr const_pointer data() const noexcept {
+    return heap_ ? heap_ : inline_.data();
+  }
+
+  [[nodiscard]] constexpr allocator_type get_allocator() const noexcept {
+    return alloc_;
+  }
+
+  // True while the elements are stored inline, and not on the heap.
+  [[nodiscard]] constexpr bool is_inline() const noexcept {
+    return heap_ == nullptr;
+  }
+
+  [[nodiscard]] constexpr bool empty() const noexcept { return size() == 0; }
+
+  [[nodiscard]] constexpr size_type size() const noexcept {
+    return heap_ ? size_ : inline_.size();
+  }
+
+  [[nodiscard]] constexpr size_type max_size() const noexcept {
+    return std::max<size_type>(N, alloc_traits::max_size(alloc_));
+  }
+
+  [[nodiscard]] constexpr size_type capacity() const noexcept {
+    return heap_ ? capacity_ : N;
+  }
+
+  [[nodiscard]] static constexpr size_type inline_capacity() noexcept {
+    return N;
+  }
+
+  constexpr void reserve(size_type new_cap) {
+    if (new_cap > capacity()) spill(new_cap);
+  }
+
+  // Returns the elements to the inline storage if they fit, or otherwise
+  // trims the heap block to the number of elements.
+  constexpr void shrink_to_fit() {
+    if (heap_ == nullptr || size_ == capacity_) return;
+
+    if (size_ <= N) {
+      for (size_type i = 0; i < size_; i++)
+        inline_.push_back(std::move_if_noexcept(heap_[i]));
+      release();
+    } else {
+      spill(size_);
+    }
+  }
+
+  constexpr void clear() noexcept {
+    if (heap_) {
+      destroy(0, size_);
+      size_ = 0;
+    } else {
+      inline_.clear();
+    }
+  }
+
+  constexpr iterator insert(const_iterator pos, const_reference value) {
+    return emplace(pos, value);
+  }
+
+  constexpr iterator insert(const_iterator pos, value_type&& value) {
+    return emplace(pos, std::move(value));
+  }
+
+  constexpr iterator insert(const_iterator pos, size_type count,
+                            const_reference value) {
+    const size_type indx = pos - begin();
+
+    if (fits(count)) {
+      inline_.insert(inline_.begin() + indx, count, value);
+    } else {
+      // Take a copy first, in case value lives in this vector
+      value_type copy(value);
+
+      make_room(count);
+      open_gap(indx, count);
+      for (size_type i = 0; i < count; i++) {
+        construct(indx + i, copy);
+        size_++;
+      }
+    }
+
+    return begin() + indx;
+  }
+
+  template <std::input_iterator InputIt>
+  constexpr iterator insert(const_iterator pos, InputIt first, InputIt last) {
+    const size_type indx = pos - begin();
+
+    if constexpr (std::forward_iterator<InputIt>) {
+      const size_type count = std::distance(first, last);
+
+      if (fits(count)) {
+        inline_.insert(inline_.begin() + indx, first, last);
+      } else {
+        make_room(count);
+        open_gap(indx, count);
+        for (size_type i = 0; i < count; i++) {
+          construct(indx + i, *first++);
+          size_++;
+        }
+      }
+    } else {
+      // The length is not known in advance, so add one at a time
+      for (size_type i = indx; first != last; i++)
+        emplace(begin() + i, *first++);
+    }
+
+    return begin() + indx;
+  }
+
+  constexpr iterator insert(const_iterator pos,
+                            std::initializer_list<value_type> init) {
+    return insert(pos, init.begin(), init.end());
+  }
+
+  template <class... Args>
+  constexpr iterator emplace(const_iterator pos, Args&&... args) {
+    const size_type indx = pos - begin();
+
+    if (fits(1)) {
+      inline_.emplace(inline_.begin() + indx, std::forward<Args>(args)...);
+    } else {
+      // Build the new element first, in case args refer to this vector
+      value_type value(std::forward<Args>(args)...);
+
+      make_room(1);
+      open_gap(indx, 1);
+      construct(indx, std::move(value));
+      size_++;
+    }
+
+    return begin() + indx;
+  }
+
+  constexpr iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
+
+  constexpr iterator erase(const_iterator first, const_iterator last) {
+    const size_type indx_first = first - begin();
+    const size_type indx_last = last - begin();
+
+    if (heap_ == nullptr) {
+      inline_.erase(inline_.begin() + indx_first, inline_.begin() + indx_last);
+    } else if (indx_first != indx_last) {
+      // Move all objects backwards, then destroy the left over tail
+      std::move(heap_ + indx_last, heap_ + size_, heap_ + indx_first);
+      const size_type new_size = size_ - (indx_last - indx_first);
+      destroy(new_size, size_);
+      size_ = new_size;
+    }
+
+    return begin() + indx_first;
+  }
+
+  constexpr void push_back(const_reference value) { emplace_back(value); }
+
+  constexpr void push_back(value_type&& value) {
+    emplace_back(std::move(value));
+  }
+
+  template <class... Args>
+  constexpr reference emplace_back(Args&&... args) {
+    if (fits(1)) {
+      inline_.emplace_back(std::forward<Args>(args)...);
+      return inline_.back();
+    }
+
+    if (size() == capacity()) {
+      // Build the new element first, in case args refer to this vector
+      value_type value(std::forward<Args>(args)...);
+      make_room(1);
+      construct(size_, std::move(value));
+    } else {
+      construct(size_, std::forward<Args>(args)...);
+    }
+    size_++;
+
+    return heap_[size_ - 1];
+  }
+
+  constexpr void pop_back() {
+    if (heap_) {
+      if (size_ > 0) {
+        destroy(size_ - 1, size_);
+        size_--;
+      }
+    } else {
+      inline_.pop_back();
+    }
+  }
+
+  constexpr void resize(size_type count) {
+    if (count > size()) reserve(count);
+
+    while (size() > count) pop_back();
+    while (size() < count) emplace_back();
+  }
+
+  constexpr void resize(size_type count, const_reference value) {
+    if (count > size()) {
+      // Take a copy first, in case value lives in this vector
+      value_type copy(value);
+      reserve(count);
+      while (size() < count) push_back(copy);
+    }
+
+    while (size() > count) pop_back();
+  }
+
+  [[nodiscard]] constexpr iterator begin() noexcept { return data(); }
+
+  [[nodiscard]] constexpr const_iterator begin() const noexcept {
+    return data();
+  }
+
+  [[nodiscard]] constexpr const_iterator cbegin() const noexcept {
+    return data();
+  }
+
+  [[nodiscard]] constexpr iterator end() noexcept { return data() + size(); }
+
+  [[nodiscard]] constexpr const_iterator end() const noexcept {
+    return data() + size();
+  }
+
+  [[nodiscard]] constexpr const_iterator cend() const noexcept {
+    return data() + size();
+  }
+
+  [[nodiscard]] constexpr reverse_iterator rbegin() noexcept {
+    return reverse_iterator(end());
+  }
+
+  [[nodiscard]] constexpr const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  [[nodiscard]] constexpr const_reverse_iterator crbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  [[nodiscard]] constexpr reverse_iterator rend() noexcept {
+    return reverse_iterator(begin());
+  }
+
+  [[nodiscard]] constexpr const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  [[nodiscard]] constexpr const_reverse_iterator crend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+ private:
+  using alloc_traits = std::allocator_traits<allocator_type>;
+
+  static_assert(std::is_same_v<typename alloc_traits::value_type, T>,
+                "htl::small_vector: Allocator::value_type must be T");
+
+  static_vector<value_type, N> inline_;
+  [[no_unique_address]] allocator_type alloc_;
+  pointer heap_;        // Heap block, or nullptr while the elements are inline
+  size_type size_;      // Number of elements in the heap block
+  size_type capacity_;  // Number of elements the heap block can hold
+
+  // True if count more elements may be added to the inline storage.
+  [[nodiscard]] constexpr bool fits(size_type count) const noexcept {
+    return heap_ == nullptr && inline_.size() + count <= N;
+  }
+
+  // Ensures that the elements are on the heap, with room for count more.
+  constexpr void make_room(size_type count) {
+    const size_type required = size() + count;
+
+    if (required > max_size()) {
+      throw std::length_error(
+          "htl::small_vector::make_room: Cannot extend capacity");
+    }
+
+    if (heap_ == nullptr || required > capacity_) {
+      spill(std::max(required, 2 * capacity()));
+    }
+  }
+
+  // Moves the elements into a new heap block of new_cap elements.
+  constexpr void spill(size_type new_cap) {
+    pointer block = alloc_traits::allocate(alloc_, new_cap);
+    const size_type count = size();
+    pointer old = data();
+    size_type i = 0;
+
+    try {
+      for (; i < count; i++) {
+        alloc_traits::construct(alloc_, block + i,
+                                std::move_if_noexcept(old[i]));
+      }
+    } catch (...) {
+      for (size_type j = 0; j < i; j++)
+        alloc_traits::destroy(alloc_, block + j);
+      alloc_traits::deallocate(alloc_, block, new_cap);
+      throw;
+    }
+
+    release();
+    heap_ = block;
+    size_ = count;
+    capacity_ = new_cap;
+  }
+
+  // Destroys every element and gives back the heap block, if there is one.
+  constexpr void release() noexcept {
+    if (heap_) {
+      destroy(0, size_);
+      alloc_traits::deallocate(alloc_, heap_, capacity_);
+      heap_ = nullptr;
+      size_ = 0;
+      capacity_ = 0;
+    } else {
+      inline_.clear();
+    }
+  }
+
+  template <class... Args>
+  constexpr void construct(size_type i, Args&&... args) {
+    alloc_traits::construct(alloc_, heap_ + i, std::forward<Args>(args)...);
+  }
+
+  constexpr void destroy(size_type first, size_type last) noexcept {
+    if constexpr (!std::is_trivially_destructible_v<value_type>) {
+      for (size_type i = first; i < last; i++)
+        alloc_traits::destroy(alloc_, heap_ + i);
+    }
+  }
+
+  // Moves the heap elements from indx onwards forward by count spots,
+  // leaving count uninitialized slots at indx. The size is left unchanged.
+  constexpr void open_gap(size_type indx, size_type count) {
+    for (size_type i = size_; i > indx; i--) {
+      construct(i - 1 + count, std::move(heap_[i - 1]));
+      destroy(i - 1, i);
+    }
+  }
+
+  constexpr void check_index(size_type i) const {
+    if (i >= size())
+      throw std::out_of_range(
+          "htl::small_vector::check_index: i >= this->size()");
+  }
+};
+
+}  // namespace htl
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef HTL_SPARSE_JACOBIAN_H
+#define HTL_SPARSE_JACOBIAN_H
+
+#include <algorithm>
+#include <cstddef>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "dual.hpp"
+#include "jacobian.hpp"
+#include "ndarray.hpp"
+
+namespace htl {
+
+// The positions of the nonzeros of an m by n Jacobian, stored by row. On
+// construction, the columns are colored so that no two columns of the same
+// color have a nonzero in the same row. Such columns can share one tangent,
+// since each output then depends on at most one of them, so a full Jacobian
+// needs one tangent per color instead of one per column. Columns are colored
+// greedily, in order, which is optimal for banded patterns.
+class sparsity_pattern {
+ public:
+  using size_type = std::size_t;
+  using entry_type = std::pair<size_type, size_type>;
+
+  sparsity_pattern() : rows_(0), cols_(0), row_start_(1, 0), colors_(0) {}
+
+  // Builds the pattern from (row, column) pairs, in any order. Duplicates
+  // are ignored.
+  sparsity_pattern(size_type rows, size_type cols,
+                   std::vector<entry_type> entries)
+      : rows_(rows), cols_(cols), row_start_(rows + 1, 0), colors_(0) {
+    std::sort(entries.begin(), entries.end());
+    entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+
+    col_index_.reserve(entries.size());
+    for (const auto& [r, c] : entries) {
+      if (r >= rows_ || c >= cols_) {
+        throw std::out_of_range(
+            "htl::sparsity_pattern: entry lies outside of the matrix");
+      }
+
+      row_start_[r + 1]++;
+      col_index_.push_back(c);
+    }
+
+    for (size_type r = 0; r < rows_; r++) row_start_[r + 1] += row_start_[r];
+
+    color_columns();
+  }
+
+  [[nodiscard]] size_type rows() const noexcept { return rows_; }
+  [[nodiscard]] size_type cols() const noexcept { return cols_; }
+  [[nodiscard]] size_type nonzeros() const noexcept {
+    return col_index_.size();
+  }
+
+  // Columns of the nonzeros in row r, in increasing order. Nonzero k of the
+  // pattern is the k'th one when reading the rows in order.
+  [[nodiscard]] std::span<const size_type> row(size_type r) const {
+    return std::span<const size_type>(col_index_.data() + row_start_[r],
+                                      row_start_[r + 1] - row_start_[r]);
+  }
+
+  // Index of the first nonzero of row r.
+  [[nodiscard]] size_type row_start(size_type r) const {
+    return row_start_[r];
+  }
+
+  [[nodiscard]] size_type color(size_type c) const { return color_[c]; }
+  [[nodiscard]] size_type colors() const noexcept { return colors_; }
+
+ private:
+  size_type rows_, cols_;
+  std::vector<size_type> row_start_;
+  std::vector<size_type> col_index_;
+  std::vector<size_type> color_;
+  size_type colors_;
+
+  void color_columns() {
+    // Rows of the nonzeros of each column.
+    std::vector<size_type> col_start(cols_ + 1, 0);
+    for (size_type c : col_index_) col_start[c + 1]++;
+    for (size_type c = 0; c < cols_; c++) col_start[c + 1] += col_start[c];
+
+    std::vector<size_type> row_index(col_index_.size());
+    std::vector<size_type> fill(col_start.begin(), col_start.end() - 1);
+    for (size_type r = 0; r < rows_; r++) {
+      for (size_type c : row(r)) row_index[fill[c]++] = r;
+    }
+
+    // forbidden[k] == c + 1 when color k is taken by a neighbour of column c.
+    std::vector<size_type> forbidden;
+    color_.assign(cols_, 0);
+
+    for (size_type c = 0; c < cols_; c++) {
+      for (size_type k = col_start[c]; k < col_start[c + 1]; k++) {
+        for (size_type other : row(row_index[k])) {
+          if (other < c) forbidden[color_[other]] = c + 1;
+        }
+      }
+
+      size_type k = 0;
+      while (k < forbidden.size() && forbidden[k] == c + 1) k++;
+      if (k == forbidden.size()) forbidden.push_back(0);
+
+      color_[c] = k;
+      colors_ = std::max(colors_, k + 1);
+    }
+  }
+};
+
+namespace details {
+
+// Pass p of a compressed sweep seeds the colors [p * N, p * N + N); every
+// input takes the tangent of its column's color.
+template <std::size_t N>
+struct color_seed {
+  const sparsity_pattern* pattern;
+
+  template <std::floating_point T>
+  void operator()(std::size_t p, std::span<dual<T, N>> x, T v) const {
+    for (std::size_t i = 0; i < x.size(); i++) {
+      const std::size_t k = pattern->color(i) - p * N;
+      if (k < N) x[i].epsilon(k, v);
+    }
+  }
+};
+
+}  // namespace details
+
+// Returns the nonzeros of the Jacobian of f at x, whose structure is given
+// by pattern, in the order of the pattern's nonzeros. f is called as for
+// htl::jacobian, but only once per N colors instead of once per N columns,
+// and each output tangent is then split back into the columns of its color.
+// The pattern must include every nonzero: one that is missing shares its
+// tangent with the columns of the same color, so it is silently added to the
+// entry of such a column in its row, when there is one, and dropped
+// otherwise. An incomplete pattern therefore corrupts other entries.
+template <std::size_t N = 8, typename F, details::input_range R>
+requires(N != std::dynamic_extent && N > 0)
+[[nodiscard]] auto sparse_jacobian(const F& f, const R& x,
+                                   const sparsity_pattern& pattern,
+                                   std::size_t threads = 0) {
+  using T = std::ranges::range_value_t<R>;
+  const std::span<const T> xs(std::ranges::data(x), std::ranges::size(x));
+
+  if (xs.size() != pattern.cols()) {
+    throw std::runtime_error(
+        "htl::sparse_jacobian: number of inputs does not match pattern");
+  }
+
+  ndarray<T> out({pattern.nonzeros()});
+  details::sweep<N>(
+      f, xs, 0, details::passes<N>(pattern.colors()), threads,
+      details::color_seed<N>{&pattern}, [&](std::size_t p, const auto& y) {
+        if (std::ranges::size(y) != pattern.rows()) {
+          throw std::runtime_error(
+              "htl::sparse_jacobian: number of outputs does not match "
+              "pattern");
+        }
+
+        std::size_t r = 0;
+        for (const dual<T, N>& yr : y) {
+          std::size_t nz = pattern.row_start(r);
+          for (std::size_t c : pattern.row(r)) {
+            const std::size_t k = pattern.color(c) - p * N;
+            if (k < N) out[nz] = yr.epsilons()[k];
+            nz++;
+          }
+          r++;
+        }
+      });
+
+  return out;
+}
+
+}  // namespace htl
+
+#endif
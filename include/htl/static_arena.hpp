@@ -10,13 +10,12 @@ class static_arena : public details::base_arena {
  public:
   static_arena() {
     if (CAPACITY > 0) {
-      data_ = &data_array_[0];
-      offset_ = data_;
-      prev_offset_ = offset_;
-      end_ = data_ + CAPACITY;
+      this->set_block(&data_array_[0], CAPACITY);
     }
   }
 
+  ~static_arena() { this->release_block(); }
+
   // Because the memory is stored within the class, we cannot safely
   // copy or move instances of a static arena.
   static_arena(const static_arena& other) = delete;
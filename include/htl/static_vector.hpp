@@ -3,10 +3,13 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <initializer_list>
 #include <iterator>
+#include <memory>
 #include <stdexcept>
 #include <type_traits>
+#include <utility>
 
 namespace htl {
 
@@ -25,9 +28,10 @@ class static_vector {
   using reverse_iterator = std::reverse_iterator<iterator>;
   using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
-  static_vector() : data_(), size_(0) {}
+  constexpr static_vector() noexcept : size_(0) { activate(); }
 
-  static_vector(std::size_t count, const_reference value) : data_(), size_(0) {
+  constexpr static_vector(std::size_t count, const_reference value) : size_(0) {
+    activate();
     check_capacity(count);
 
     try {
@@ -38,7 +42,8 @@ class static_vector {
     }
   }
 
-  explicit static_vector(std::size_t count) : data_(), size_(0) {
+  constexpr explicit static_vector(std::size_t count) : size_(0) {
+    activate();
     check_capacity(count);
 
     try {
@@ -49,9 +54,14 @@ class static_vector {
     }
   }
 
-  template <class InputIt>
-  static_vector(InputIt first, InputIt last) : data_(), size_(0) {
-    check_capacity(std::distance(first, last));
+  template <std::input_iterator InputIt>
+  constexpr static_vector(InputIt first, InputIt last) : size_(0) {
+    activate();
+    // Single pass iterators can only be counted by consuming them, so they
+    // are checked one element at a time by push_back
+    if constexpr (std::forward_iterator<InputIt>) {
+      check_capacity(std::distance(first, last));
+    }
 
     try {
       for (auto it = first; it != last; it++) push_back(*it);
@@ -61,26 +71,30 @@ class static_vector {
     }
   }
 
-  static_vector(const static_vector& other) : data_(), size_(0) {
-    try {
-      for (const auto& val : other) push_back(val);
-    } catch (...) {
-      clear();
-      throw;
-    }
+  // When T is trivially copyable, so is the static_vector, which allows it
+  // to be copied with memcpy, or sent around as raw bytes.
+  constexpr static_vector(const static_vector& other) requires
+      std::is_trivially_copyable_v<T> = default;
+
+  constexpr static_vector(const static_vector& other) noexcept(
+      std::is_nothrow_copy_constructible_v<value_type>)
+      : size_(0) {
+    activate();
+    copy_elements(other);
   }
 
-  static_vector(static_vector&& other) : data_(), size_(0) {
-    try {
-      for (std::size_t i = 0; i < other.size(); i++)
-        push_back(std::move(other[i]));
-    } catch (...) {
-      clear();
-      throw;
-    }
+  constexpr static_vector(static_vector&& other) requires
+      std::is_trivially_copyable_v<T> = default;
+
+  constexpr static_vector(static_vector&& other) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>)
+      : size_(0) {
+    activate();
+    move_elements(other);
   }
 
-  static_vector(std::initializer_list<value_type> init) : data_(), size_(0) {
+  constexpr static_vector(std::initializer_list<value_type> init) : size_(0) {
+    activate();
     check_capacity(init.size());
 
     try {
@@ -91,38 +105,33 @@ class static_vector {
     }
   }
 
-  static_vector& operator=(const static_vector& other) {
+  constexpr static_vector& operator=(const static_vector& other) requires
+      std::is_trivially_copyable_v<T> = default;
+
+  constexpr static_vector& operator=(const static_vector& other) noexcept(
+      std::is_nothrow_copy_constructible_v<value_type>) {
     if (this != &other) {
       clear();
-
-      try {
-        for (const auto& item : other) push_back(item);
-      } catch (...) {
-        clear();
-        throw;
-      }
+      copy_elements(other);
     }
 
     return *this;
   }
 
-  static_vector& operator=(static_vector&& other) {
+  constexpr static_vector& operator=(static_vector&& other) requires
+      std::is_trivially_copyable_v<T> = default;
+
+  constexpr static_vector& operator=(static_vector&& other) noexcept(
+      std::is_nothrow_move_constructible_v<value_type>) {
     if (this != &other) {
       clear();
-
-      try {
-        for (size_type i = 0; i < other.size(); i++)
-          push_back(std::move(other[i]));
-      } catch (...) {
-        clear();
-        throw;
-      }
+      move_elements(other);
     }
 
     return *this;
   }
 
-  static_vector& operator=(std::initializer_list<value_type> init) {
+  constexpr static_vector& operator=(std::initializer_list<value_type> init) {
     check_capacity(init.size());
     clear();
 
@@ -136,48 +145,55 @@ class static_vector {
     return *this;
   }
 
-  ~static_vector() {
+  constexpr ~static_vector() requires std::is_trivially_destructible_v<T> =
+      default;
+
+  constexpr ~static_vector() {
     // Destroy all objects we contain first
     clear();
   }
 
-  [[nodiscard]] reference at(std::size_t i) {
+  [[nodiscard]] constexpr reference at(std::size_t i) {
     check_index(i);
 
     return index(i);
   }
 
-  [[nodiscard]] const_reference at(std::size_t i) const {
+  [[nodiscard]] constexpr const_reference at(std::size_t i) const {
     check_index(i);
 
     return index(i);
   }
 
-  [[nodiscard]] reference operator[](std::size_t i) { return index(i); }
+  [[nodiscard]] constexpr reference operator[](std::size_t i) {
+    return index(i);
+  }
 
-  [[nodiscard]] const_reference operator[](std::size_t i) const {
+  [[nodiscard]] constexpr const_reference operator[](std::size_t i) const {
     return index(i);
   }
 
-  [[nodiscard]] reference front() { return index(0); }
+  [[nodiscard]] constexpr reference front() { return index(0); }
 
-  [[nodiscard]] const_reference front() const { return index(0); }
+  [[nodiscard]] constexpr const_reference front() const { return index(0); }
 
-  [[nodiscard]] reference back() { return index(size_ - 1); }
+  [[nodiscard]] constexpr reference back() { return index(size_ - 1); }
 
-  [[nodiscard]] const_reference back() const { return index(size_ - 1); }
+  [[nodiscard]] constexpr const_reference back() const {
+    return index(size_ - 1);
+  }
 
-  [[nodiscard]] pointer data() { return reinterpret_cast<pointer>(&data_[0]); }
+  [[nodiscard]] constexpr pointer data() { return ptr(0); }
 
-  [[nodiscard]] const_pointer data() const {
-    return reinterpret_cast<const_pointer>(&data_[0]);
-  }
+  [[nodiscard]] constexpr const_pointer data() const { return ptr(0); }
 
-  [[nodiscard]] bool empty() const noexcept { return size_ == 0; }
+  [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
 
-  [[nodiscard]] bool full() const noexcept { return size_ == capacity(); }
+  [[nodiscard]] constexpr bool full() const noexcept {
+    return size_ == capacity();
+  }
 
-  [[nodiscard]] size_type size() const noexcept { return size_; }
+  [[nodiscard]] constexpr size_type size() const noexcept { return size_; }
 
   [[nodiscard]] constexpr size_type max_size() const noexcept {
     return capacity();
@@ -187,90 +203,104 @@ class static_vector {
     return CAPACITY;
   }
 
-  void clear() noexcept {
+  constexpr void clear() noexcept {
     if ((std::is_trivially_destructible<value_type>::value == false) &&
         (size_ > 0)) {
       // Call all destructors
-      for (size_type i = 0; i < size_; i++) index(i).~value_type();
+      for (size_type i = 0; i < size_; i++) std::destroy_at(ptr(i));
     }
 
     size_ = 0;
   }
 
-  iterator insert(const_iterator pos, const_reference value) {
+  constexpr iterator insert(const_iterator pos, const_reference value) {
     check_capacity(1);
     const size_type indx = pos - begin();
 
+    // Take a copy first, in case value lives in this vector
+    value_type copy(value);
+
     // First, move all objects forward one spot
-    std::move_backward(begin() + indx, end(), end() + 1);
+    open_gap(indx, 1);
 
     // Now insert new element
-    new (begin() + indx) value_type(value);
+    construct(indx, std::move(copy));
     size_++;
 
     return begin() + indx;
   }
 
-  iterator insert(const_iterator pos, value_type&& value) {
+  constexpr iterator insert(const_iterator pos, value_type&& value) {
     check_capacity(1);
     const size_type indx = pos - begin();
 
     // First, move all objects forward one spot
-    std::move_backward(begin() + indx, end(), end() + 1);
+    open_gap(indx, 1);
 
     // Now insert new element
-    new (begin() + indx) value_type(value);
+    construct(indx, std::move(value));
     size_++;
 
     return begin() + indx;
   }
 
-  iterator insert(const_iterator pos, size_type count, const_reference value) {
+  constexpr iterator insert(const_iterator pos, size_type count,
+                            const_reference value) {
     check_capacity(count);
     const size_type indx = pos - begin();
 
+    // Take a copy first, in case value lives in this vector
+    value_type copy(value);
+
     // First, move all objects forward count spots
-    std::move_backward(begin() + indx, end(), end() + count);
+    open_gap(indx, count);
 
     // Now insert new element
     for (size_type i = 0; i < count; i++) {
-      new (begin() + indx + i) value_type(value);
+      construct(indx + i, copy);
       size_++;
     }
 
     return begin() + indx;
   }
 
-  template <class InputIt>
-  iterator insert(const_iterator pos, InputIt first, InputIt last) {
-    const size_type count = std::distance(first, last);
-
-    check_capacity(count);
+  template <std::input_iterator InputIt>
+  constexpr iterator insert(const_iterator pos, InputIt first, InputIt last) {
     const size_type indx = pos - begin();
 
-    // First, move all objects forward count spots
-    std::move_backward(begin() + indx, end(), end() + count);
+    if constexpr (std::forward_iterator<InputIt>) {
+      const size_type count = std::distance(first, last);
+      check_capacity(count);
 
-    // Now insert new element
-    for (size_type i = 0; i < count; i++) {
-      new (begin() + indx + i) value_type(*first++);
-      size_++;
+      // First, move all objects forward count spots
+      open_gap(indx, count);
+
+      // Now insert new element
+      for (size_type i = 0; i < count; i++) {
+        construct(indx + i, *first++);
+        size_++;
+      }
+    } else {
+      // The length is not known in advance, so add one at a time
+      for (size_type i = indx; first != last; i++)
+        emplace(begin() + i, *first++);
     }
 
     return begin() + indx;
   }
 
-  iterator insert(const_iterator pos, std::initializer_list<value_type> init) {
+  constexpr iterator insert(const_iterator pos,
+                            std::initializer_list<value_type> init) {
     check_capacity(init.size());
     const size_type indx = pos - begin();
 
     // First, move all objects forward one spot
-    std::move_backward(begin() + indx, end(), end() + init.size());
+    open_gap(indx, init.size());
 
     // Now insert new element
     size_type i = 0;
     for (auto it = init.begin(); it != init.end(); it++) {
-      new (begin() + indx + i) value_type(*it);
+      construct(indx + i, *it);
       size_++;
       i++;
     }
@@ -279,84 +309,77 @@ class static_vector {
   }
 
   template <class... Args>
-  iterator emplace(const_iterator pos, Args&&... args) {
+  constexpr iterator emplace(const_iterator pos, Args&&... args) {
     check_capacity(1);
     const size_type indx = pos - begin();
 
+    // Build the new element first, in case args refer to this vector
+    value_type value(std::forward<Args>(args)...);
+
     // First, move all objects forward one spot
-    std::move_backward(begin() + indx, end(), end() + 1);
+    open_gap(indx, 1);
 
     // Now insert new element
-    new (begin() + indx) value_type(args...);
+    construct(indx, std::move(value));
     size_++;
 
     return begin() + indx;
   }
 
-  iterator erase(const_iterator pos) {
-    const size_type indx = pos - begin();
-
-    // First, destroy object at pos
-    pos->~value_type();
-
-    // Move all objects backwards one spot
-    std::move(begin() + indx + 1, end(), begin() + indx);
+  constexpr iterator erase(const_iterator pos) { return erase(pos, pos + 1); }
 
-    // Reduce size
-    size_--;
-
-    return begin() + indx;
-  }
-
-  iterator erase(const_iterator first, const_iterator last) {
-    if (first == last) return last;
+  constexpr iterator erase(const_iterator first, const_iterator last) {
+    if (first == last) return begin() + (last - begin());
     const size_type indx_first = first - begin();
     const size_type indx_last = last - begin();
+    const size_type count = indx_last - indx_first;
 
-    // First, destroy object at pos
-    for (iterator it = first; it != last; it++) {
-      it->~value_type();
-    }
+    if constexpr (TRIVIAL_COPY) {
+      // Slide the tail back over the erased elements in one go
+      move_bytes(ptr(indx_first), ptr(indx_last), size_ - indx_last, false);
+    } else {
+      // Move all objects backwards, then destroy the left over tail
+      std::move(begin() + indx_last, end(), begin() + indx_first);
 
-    // Move all objects backwards one spot
-    std::move(begin() + indx_last, end(), begin() + indx_first);
+      for (size_type i = size_ - count; i < size_; i++) std::destroy_at(ptr(i));
+    }
 
     // Reduce size
-    size_ -= std::distance(first, last);
+    size_ -= count;
 
     return begin() + indx_first;
   }
 
-  void push_back(const_reference value) {
+  constexpr void push_back(const_reference value) {
     check_capacity();
 
-    new (static_cast<void*>(&data_[size_])) value_type(value);
+    construct(size_, value);
     size_++;
   }
 
-  void push_back(value_type&& value) {
+  constexpr void push_back(value_type&& value) {
     check_capacity();
 
-    new (static_cast<void*>(&data_[size_])) value_type(value);
+    construct(size_, std::move(value));
     size_++;
   }
 
   template <class... Args>
-  void emplace_back(Args&&... args) {
+  constexpr void emplace_back(Args&&... args) {
     check_capacity();
 
-    new (static_cast<void*>(&data_[size_])) value_type(args...);
+    construct(size_, std::forward<Args>(args)...);
     size_++;
   }
 
-  void pop_back() {
+  constexpr void pop_back() {
     if (size_ > 0) {
-      index(size_ - 1).~value_type();
+      std::destroy_at(ptr(size_ - 1));
       size_--;
     }
   }
 
-  void resize(size_type count) {
+  constexpr void resize(size_type count) {
     const size_type diff = count < size_ ? size_ - count : count - size_;
 
     if (count < size_) {
@@ -368,7 +391,7 @@ class static_vector {
     }
   }
 
-  void resize(size_type count, const_reference value) {
+  constexpr void resize(size_type count, const_reference value) {
     const size_type diff = count < size_ ? size_ - count : count - size_;
 
     if (count < size_) {
@@ -380,88 +403,197 @@ class static_vector {
     }
   }
 
-  [[nodiscard]] iterator begin() noexcept {
-    return reinterpret_cast<iterator>(&data_[0]);
+  [[nodiscard]] constexpr iterator begin() noexcept {
+    return ptr(0);
   }
 
-  [[nodiscard]] const_iterator begin() const noexcept {
-    return reinterpret_cast<const_iterator>(&data_[0]);
+  [[nodiscard]] constexpr const_iterator begin() const noexcept {
+    return ptr(0);
   }
 
-  [[nodiscard]] const_iterator cbegin() const noexcept {
-    return reinterpret_cast<const_iterator>(&data_[0]);
+  [[nodiscard]] constexpr const_iterator cbegin() const noexcept {
+    return ptr(0);
   }
 
-  [[nodiscard]] iterator end() noexcept {
-    return reinterpret_cast<iterator>(&data_[size_]);
+  [[nodiscard]] constexpr iterator end() noexcept {
+    return ptr(size_);
   }
 
-  [[nodiscard]] const_iterator end() const noexcept {
-    return reinterpret_cast<const_iterator>(&data_[size_]);
+  [[nodiscard]] constexpr const_iterator end() const noexcept {
+    return ptr(size_);
   }
 
-  [[nodiscard]] const_iterator cend() const noexcept {
-    return reinterpret_cast<const_iterator>(&data_[size_]);
+  [[nodiscard]] constexpr const_iterator cend() const noexcept {
+    return ptr(size_);
   }
 
-  [[nodiscard]] reverse_iterator rbegin() noexcept {
+  [[nodiscard]] constexpr reverse_iterator rbegin() noexcept {
     return reverse_iterator(end());
   }
 
-  [[nodiscard]] const_reverse_iterator rbegin() const noexcept {
+  [[nodiscard]] constexpr const_reverse_iterator rbegin() const noexcept {
     return reverse_iterator(end());
   }
 
-  [[nodiscard]] const_reverse_iterator crbegin() const noexcept {
+  [[nodiscard]] constexpr const_reverse_iterator crbegin() const noexcept {
     return reverse_iterator(end());
   }
 
-  [[nodiscard]] reverse_iterator rend() noexcept {
+  [[nodiscard]] constexpr reverse_iterator rend() noexcept {
     return reverse_iterator(begin());
   }
 
-  [[nodiscard]] const_reverse_iterator rend() const noexcept {
+  [[nodiscard]] constexpr const_reverse_iterator rend() const noexcept {
     return reverse_iterator(begin());
   }
 
-  [[nodiscard]] const_reverse_iterator crend() const noexcept {
+  [[nodiscard]] constexpr const_reverse_iterator crend() const noexcept {
     return reverse_iterator(begin());
   }
 
  private:
-  struct storage_type {
-    alignas(value_type) unsigned char data[sizeof(value_type)];
+  // Trivially copyable types are shifted with memmove, rather than one
+  // element at a time.
+  static constexpr bool TRIVIAL_COPY = std::is_trivially_copyable_v<T>;
+
+  // Trivial types are stored in a union. This leaves the elements
+  // uninitialized, while still allowing them to be used during constant
+  // evaluation. Other types are stored as raw bytes, and can only be used at
+  // run time.
+  static constexpr bool UNION_STORAGE = std::is_trivial_v<T>;
+
+  union trivial_storage {
+    value_type data[CAPACITY];
+
+    constexpr trivial_storage() noexcept {}
+  };
+
+  struct raw_storage {
+    struct slot {
+      alignas(value_type) unsigned char data[sizeof(value_type)];
+    };
+
+    slot data[CAPACITY];
   };
 
-  storage_type data_[CAPACITY];
+  using storage_type =
+      std::conditional_t<UNION_STORAGE, trivial_storage, raw_storage>;
+
+  storage_type storage_;
   size_type size_;
 
-  void check_index(const std::size_t& i) {
+  // During constant evaluation, every element must be initialized before it
+  // may be read or written through a pointer.
+  constexpr void activate() noexcept {
+    if constexpr (UNION_STORAGE) {
+      if (std::is_constant_evaluated()) {
+        for (size_type i = 0; i < CAPACITY; i++) {
+          storage_.data[i] = value_type();
+        }
+      }
+    }
+  }
+
+  [[nodiscard]] constexpr pointer ptr(size_type i) noexcept {
+    if constexpr (UNION_STORAGE) {
+      return storage_.data + i;
+    } else {
+      return reinterpret_cast<pointer>(&storage_.data[i]);
+    }
+  }
+
+  [[nodiscard]] constexpr const_pointer ptr(size_type i) const noexcept {
+    if constexpr (UNION_STORAGE) {
+      return storage_.data + i;
+    } else {
+      return reinterpret_cast<const_pointer>(&storage_.data[i]);
+    }
+  }
+
+  template <class... Args>
+  constexpr void construct(size_type i, Args&&... args) {
+    if constexpr (UNION_STORAGE) {
+      storage_.data[i] = value_type(std::forward<Args>(args)...);
+    } else {
+      std::construct_at(ptr(i), std::forward<Args>(args)...);
+    }
+  }
+
+  constexpr void check_index(const std::size_t& i) const {
     if (i >= size_)
       throw std::out_of_range(
           "htl::static_vector::check_index: i >= this->size()");
   }
 
-  void check_capacity() {
+  constexpr void check_capacity() {
     if (size_ == capacity()) {
       throw std::length_error(
           "htl::static_vector::check_capacity: Cannot extend capacity");
     }
   }
 
-  void check_capacity(const size_type& count_to_add) {
+  constexpr void check_capacity(const size_type& count_to_add) {
     if (size_ + count_to_add > capacity()) {
       throw std::length_error(
           "htl::static_vector::check_capacity: Cannot extend capacity");
     }
   }
 
-  [[nodiscard]] reference index(const std::size_t& i) {
-    return *reinterpret_cast<pointer>(&data_[i]);
+  // Copies n trivially copyable elements from src to dest, which may
+  // overlap. The elements are copied front to back, unless backward is true.
+  static constexpr void move_bytes(pointer dest, const_pointer src,
+                                   size_type n, bool backward) noexcept {
+    if (std::is_constant_evaluated()) {
+      if (backward) {
+        std::copy_backward(src, src + n, dest + n);
+      } else {
+        std::copy(src, src + n, dest);
+      }
+    } else {
+      std::memmove(static_cast<void*>(dest), static_cast<const void*>(src),
+                   n * sizeof(value_type));
+    }
+  }
+
+  // Copies the elements of other into this empty vector, one at a time.
+  constexpr void copy_elements(const static_vector& other) {
+    try {
+      for (const auto& val : other) push_back(val);
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+
+  constexpr void move_elements(static_vector& other) {
+    try {
+      for (size_type i = 0; i < other.size(); i++)
+        push_back(std::move(other[i]));
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
+
+  // Moves the elements from indx onwards forward by count spots, leaving
+  // count uninitialized slots at indx. The size is left unchanged.
+  constexpr void open_gap(size_type indx, size_type count) {
+    if constexpr (TRIVIAL_COPY) {
+      move_bytes(ptr(indx + count), ptr(indx), size_ - indx, true);
+    } else {
+      for (size_type i = size_; i > indx; i--) {
+        std::construct_at(ptr(i - 1 + count), std::move(index(i - 1)));
+        std::destroy_at(ptr(i - 1));
+      }
+    }
+  }
+
+  [[nodiscard]] constexpr reference index(const std::size_t& i) {
+    return *ptr(i);
   }
 
-  [[nodiscard]] const_reference index(const std::size_t& i) const {
-    return *reinterpret_cast<const_pointer>(&data_[i]);
+  [[nodiscard]] constexpr const_reference index(const std::size_t& i) const {
+    return *ptr(i);
   }
 };
 }  // namespace htl
@@ -0,0 +1,140 @@
+#ifndef HTL_STRIDED_SPAN_H
+#define HTL_STRIDED_SPAN_H
+
+#include <compare>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+
+namespace htl {
+
+// A non-owning view of size elements, each stride elements apart, such as
+// one component of an array of structures. Like std::span, the view does not
+// own its elements and is cheap to copy.
+template <typename T>
+class strided_span {
+ public:
+  using element_type = T;
+  using size_type = std::size_t;
+  using difference_type = std::ptrdiff_t;
+  using reference = T&;
+  using pointer = T*;
+
+  class iterator {
+   public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = std::remove_cv_t<T>;
+    using difference_type = std::ptrdiff_t;
+    using reference = T&;
+    using pointer = T*;
+
+    constexpr iterator() noexcept : data_(nullptr), index_(0), stride_(1) {}
+    constexpr iterator(pointer data, difference_type index,
+                       difference_type stride) noexcept
+        : data_(data), index_(index), stride_(stride) {}
+
+    [[nodiscard]] constexpr reference operator*() const {
+      return data_[index_ * stride_];
+    }
+    [[nodiscard]] constexpr pointer operator->() const {
+      return data_ + index_ * stride_;
+    }
+    [[nodiscard]] constexpr reference operator[](difference_type n) const {
+      return data_[(index_ + n) * stride_];
+    }
+
+    constexpr iterator& operator++() {
+      index_++;
+      return *this;
+    }
+    constexpr iterator operator++(int) {
+      iterator out = *this;
+      ++*this;
+      return out;
+    }
+    constexpr iterator& operator--() {
+      index_--;
+      return *this;
+    }
+    constexpr iterator operator--(int) {
+      iterator out = *this;
+      --*this;
+      return out;
+    }
+
+    constexpr iterator& operator+=(difference_type n) {
+      index_ += n;
+      return *this;
+    }
+    constexpr iterator& operator-=(difference_type n) {
+      index_ -= n;
+      return *this;
+    }
+
+    [[nodiscard]] friend constexpr iterator operator+(iterator it,
+                                                      difference_type n) {
+      return it += n;
+    }
+    [[nodiscard]] friend constexpr iterator operator+(difference_type n,
+                                                      iterator it) {
+      return it += n;
+    }
+    [[nodiscard]] friend constexpr iterator operator-(iterator it,
+                                                      difference_type n) {
+      return it -= n;
+    }
+    [[nodiscard]] friend constexpr difference_type operator-(
+        const iterator& a, const iterator& b) {
+      return a.index_ - b.index_;
+    }
+
+    [[nodiscard]] friend constexpr bool operator==(const iterator& a,
+                                                   const iterator& b) {
+      return a.index_ == b.index_;
+    }
+    [[nodiscard]] friend constexpr auto operator<=>(const iterator& a,
+                                                    const iterator& b) {
+      return a.index_ <=> b.index_;
+    }
+
+   private:
+    // The position is kept as an index, since the address one stride past
+    // the last element may lie beyond the end of the underlying array.
+    pointer data_;
+    difference_type index_;
+    difference_type stride_;
+  };
+
+  constexpr strided_span() noexcept : data_(nullptr), size_(0), stride_(1) {}
+
+  constexpr strided_span(pointer data, size_type size,
+                         size_type stride) noexcept
+      : data_(data), size_(size), stride_(stride) {}
+
+  [[nodiscard]] constexpr reference operator[](size_type i) const {
+    return data_[i * stride_];
+  }
+
+  [[nodiscard]] constexpr pointer data() const noexcept { return data_; }
+  [[nodiscard]] constexpr size_type size() const noexcept { return size_; }
+  [[nodiscard]] constexpr size_type stride() const noexcept { return stride_; }
+  [[nodiscard]] constexpr bool empty() const noexcept { return size_ == 0; }
+
+  [[nodiscard]] constexpr iterator begin() const noexcept {
+    return iterator(data_, 0, static_cast<difference_type>(stride_));
+  }
+
+  [[nodiscard]] constexpr iterator end() const noexcept {
+    return iterator(data_, static_cast<difference_type>(size_),
+                    static_cast<difference_type>(stride_));
+  }
+
+ private:
+  pointer data_;
+  size_type size_;
+  size_type stride_;
+};
+
+}  // namespace htl
+
+#endif
@@ -0,0 +1,469 @@
+#ifndef HTL_VAR_H
+#define HTL_VAR_H
+
+#include <concepts>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+#include "details/base_arena.hpp"
+#include "dual.hpp"
+
+namespace htl {
+
+template <std::floating_point T>
+class tape;
+
+namespace details {
+
+// One recorded operation. Nodes form a singly linked list, from the most
+// recent back to the first, which is the order of the reverse sweep.
+template <typename T>
+struct tape_node {
+  T adjoint;
+  T partial[2];        // Local partial derivative for each parent
+  tape_node* parent[2];
+  std::size_t n_parents;
+  tape_node* prev;
+};
+
+}  // namespace details
+
+// A variable for reverse mode automatic differentiation. Every operation on
+// a var records a node on its tape, holding the local partial derivatives.
+// Calling tape::gradient on a result then gives the derivatives of that
+// result with respect to every variable in a single reverse sweep, which
+// costs a few times as much as the function itself, however many inputs
+// there are. A var built from a plain value is a constant, and is not
+// recorded.
+template <std::floating_point T>
+class var {
+ public:
+  using value_type = T;
+  using const_reference = const value_type&;
+
+  constexpr var(const_reference v = value_type())
+      : value_(v), node_(nullptr), tape_(nullptr) {}
+
+  [[nodiscard]] constexpr value_type value() const { return value_; }
+
+  // The derivative of the output of the last tape::gradient call with
+  // respect to this var.
+  [[nodiscard]] value_type adjoint() const {
+    return node_ ? node_->adjoint : value_type();
+  }
+
+  // The tape this var is recorded on, or nullptr for a constant.
+  [[nodiscard]] tape<T>* get_tape() const { return tape_; }
+
+  [[nodiscard]] var operator+() const { return *this; }
+
+  [[nodiscard]] var operator-() const {
+    return tape<T>::record(-value_, *this, value_type(-1));
+  }
+
+  var& operator+=(const var& other) { return *this = *this + other; }
+  var& operator+=(const_reference v) { return *this = *this + v; }
+  var& operator-=(const var& other) { return *this = *this - other; }
+  var& operator-=(const_reference v) { return *this = *this - v; }
+  var& operator*=(const var& other) { return *this = *this * other; }
+  var& operator*=(const_reference v) { return *this = *this * v; }
+  var& operator/=(const var& other) { return *this = *this / other; }
+  var& operator/=(const_reference v) { return *this = *this / v; }
+
+ private:
+  friend class tape<T>;
+
+  value_type value_;
+  details::tape_node<T>* node_;
+  tape<T>* tape_;
+
+  var(const_reference v, details::tape_node<T>* node, tape<T>* t)
+      : value_(v), node_(node), tape_(t) {}
+};
+
+// Records the operations of var objects in nodes allocated from an arena, so
+// that an evaluation performs no heap allocations. Nodes are trivially
+// destructible, and are released by rewinding the tape to a marker, or by
+// clearing it. The arena must outlive the tape, and anything allocated in
+// the arena after the tape was built is released along with the nodes.
+template <std::floating_point T>
+class tape {
+ public:
+  using value_type = T;
+  using node = details::tape_node<T>;
+
+  class marker {
+   private:
+    friend class tape;
+
+    details::base_arena::marker arena_marker_;
+    node* head_;
+
+    marker(details::base_arena::marker m, node* head)
+        : arena_marker_(m), head_(head) {}
+  };
+
+  tape(details::base_arena& arena)
+      : arena_(&arena), head_(nullptr), start_(arena.mark(), nullptr) {}
+
+  // Vars hold pointers to their tape, which may not be copied or moved.
+  tape(const tape& other) = delete;
+  tape& operator=(const tape& other) = delete;
+
+  // Creates a new independent variable on the tape.
+  [[nodiscard]] var<T> variable(value_type v) {
+    return var<T>(v, push(nullptr, T(), nullptr, T()), this);
+  }
+
+  // Computes the adjoint of every var recorded before output, with respect
+  // to output.
+  void gradient(const var<T>& output) {
+    if (output.node_ == nullptr) return;
+
+    for (node* n = output.node_; n != nullptr; n = n->prev) {
+      n->adjoint = value_type();
+    }
+
+    output.node_->adjoint = value_type(1);
+
+    for (node* n = output.node_; n != nullptr; n = n->prev) {
+      for (std::size_t i = 0; i < n->n_parents; i++) {
+        n->parent[i]->adjoint += n->partial[i] * n->adjoint;
+      }
+    }
+  }
+
+  [[nodiscard]] marker mark() const { return marker(arena_->mark(), head_); }
+
+  // Releases every node recorded since the marker was taken. Vars recorded
+  // since then may no longer be used.
+  void rewind(marker m) {
+    arena_->rewind(m.arena_marker_);
+    head_ = m.head_;
+  }
+
+  void clear() { rewind(start_); }
+
+  // Records a result of value v, whose partial derivative with respect to
+  // arg is da. This may be used to add functions with known derivatives.
+  [[nodiscard]] static var<T> record(value_type v, const var<T>& a,
+                                     value_type da) {
+    if (a.tape_ == nullptr) return var<T>(v);
+
+    return var<T>(v, a.tape_->push(a.node_, da, nullptr, T()), a.tape_);
+  }
+
+  [[nodiscard]] static var<T> record(value_type v, const var<T>& a,
+                                     value_type da, const var<T>& b,
+                                     value_type db) {
+    if (a.tape_ == nullptr) return record(v, b, db);
+    if (b.tape_ == nullptr) return record(v, a, da);
+
+    return var<T>(v, a.tape_->push(a.node_, da, b.node_, db), a.tape_);
+  }
+
+ private:
+  details::base_arena* arena_;
+  node* head_;  // Most recent node
+  marker start_;
+
+  node* push(node* a, value_type da, node* b, value_type db) {
+    node* n = arena_->make<node>(
+        node{value_type(), {da, db}, {a, b}, a ? (b ? 2U : 1U) : 0U, head_});
+
+    if (n == nullptr) {
+      throw std::bad_alloc();
+    }
+
+    head_ = n;
+    return n;
+  }
+};
+
+//==========================================================
+// arithmetic
+template <typename T>
+[[nodiscard]] var<T> operator+(const var<T>& a, const var<T>& b) {
+  return tape<T>::record(a.value() + b.value(), a, T(1), b, T(1));
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator+(const var<T>& a, std::type_identity_t<T> b) {
+  return tape<T>::record(a.value() + b, a, T(1));
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator+(std::type_identity_t<T> a, const var<T>& b) {
+  return tape<T>::record(a + b.value(), b, T(1));
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator-(const var<T>& a, const var<T>& b) {
+  return tape<T>::record(a.value() - b.value(), a, T(1), b, T(-1));
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator-(const var<T>& a, std::type_identity_t<T> b) {
+  return tape<T>::record(a.value() - b, a, T(1));
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator-(std::type_identity_t<T> a, const var<T>& b) {
+  return tape<T>::record(a - b.value(), b, T(-1));
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator*(const var<T>& a, const var<T>& b) {
+  return tape<T>::record(a.value() * b.value(), a, b.value(), b, a.value());
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator*(const var<T>& a, std::type_identity_t<T> b) {
+  return tape<T>::record(a.value() * b, a, b);
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator*(std::type_identity_t<T> a, const var<T>& b) {
+  return tape<T>::record(a * b.value(), b, a);
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator/(const var<T>& a, const var<T>& b) {
+  const T inv = T(1) / b.value();
+  const T v = a.value() * inv;
+  return tape<T>::record(v, a, inv, b, -v * inv);
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator/(const var<T>& a, std::type_identity_t<T> b) {
+  return tape<T>::record(a.value() / b, a, T(1) / b);
+}
+
+template <typename T>
+[[nodiscard]] var<T> operator/(std::type_identity_t<T> a, const var<T>& b) {
+  const T inv = T(1) / b.value();
+  const T v = a * inv;
+  return tape<T>::record(v, b, -v * inv);
+}
+
+namespace details {
+
+// Records the result of a function of one var, whose value and derivative
+// have been found by evaluating it on a dual number.
+template <typename T>
+[[nodiscard]] var<T> record(const var<T>& arg, const dual<T>& result) {
+  return tape<T>::record(result.value(), arg, result.epsilon());
+}
+
+// Records the result of a function of two vars, found by evaluating it on
+// dual numbers whose first tangent follows a and second follows b.
+template <typename T>
+[[nodiscard]] var<T> record(const var<T>& a, const var<T>& b,
+                            const dual<T, 2>& result) {
+  return tape<T>::record(result.value(), a, result.epsilon(0), b,
+                         result.epsilon(1));
+}
+
+// A dual number with a unit tangent, used to find local partials.
+template <typename T>
+[[nodiscard]] dual<T> seed(const var<T>& arg) {
+  return dual<T>(arg.value(), T(1));
+}
+
+// A dual number whose i'th of two tangents is one.
+template <typename T>
+[[nodiscard]] dual<T, 2> seed(const var<T>& arg, std::size_t i) {
+  return dual<T, 2>::variable(arg.value(), i);
+}
+
+// A plain value that may be mixed with a var in a function of two arguments.
+template <typename T>
+concept var_scalar = std::is_arithmetic_v<T>;
+
+}  // namespace details
+
+//==========================================================
+// functions
+template <typename T>
+[[nodiscard]] var<T> abs(var<T> arg) {
+  return details::record(arg, htl::abs(details::seed(arg)));
+}
+
+template <typename T1, details::var_scalar T2>
+[[nodiscard]] var<T1> pow(var<T1> base, T2 exp) {
+  return details::record(base, htl::pow(details::seed(base), exp));
+}
+
+template <details::var_scalar T1, typename T2>
+[[nodiscard]] var<T2> pow(T1 base, var<T2> exp) {
+  return details::record(exp, htl::pow(base, details::seed(exp)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> pow(const var<T>& base, const var<T>& exp) {
+  return details::record(
+      base, exp, htl::pow(details::seed(base, 0), details::seed(exp, 1)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> sqrt(var<T> arg) {
+  return details::record(arg, htl::sqrt(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> cbrt(var<T> arg) {
+  return details::record(arg, htl::cbrt(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> exp(var<T> arg) {
+  return details::record(arg, htl::exp(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> exp2(var<T> arg) {
+  return details::record(arg, htl::exp2(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> expm1(var<T> arg) {
+  return details::record(arg, htl::expm1(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> log(var<T> arg) {
+  return details::record(arg, htl::log(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> log2(var<T> arg) {
+  return details::record(arg, htl::log2(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> log10(var<T> arg) {
+  return details::record(arg, htl::log10(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> log1p(var<T> arg) {
+  return details::record(arg, htl::log1p(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> sin(var<T> arg) {
+  return details::record(arg, htl::sin(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> cos(var<T> arg) {
+  return details::record(arg, htl::cos(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> tan(var<T> arg) {
+  return details::record(arg, htl::tan(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> asin(var<T> arg) {
+  return details::record(arg, htl::asin(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> acos(var<T> arg) {
+  return details::record(arg, htl::acos(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> atan(var<T> arg) {
+  return details::record(arg, htl::atan(details::seed(arg)));
+}
+
+template <typename T1, details::var_scalar T2>
+[[nodiscard]] var<T1> atan2(var<T1> y, T2 x) {
+  return details::record(y, htl::atan2(details::seed(y), x));
+}
+
+template <details::var_scalar T1, typename T2>
+[[nodiscard]] var<T2> atan2(T1 y, var<T2> x) {
+  return details::record(x, htl::atan2(y, details::seed(x)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> atan2(const var<T>& y, const var<T>& x) {
+  return details::record(
+      y, x, htl::atan2(details::seed(y, 0), details::seed(x, 1)));
+}
+
+template <typename T1, details::var_scalar T2>
+[[nodiscard]] var<T1> hypot(var<T1> x, T2 y) {
+  return details::record(x, htl::hypot(details::seed(x), y));
+}
+
+template <details::var_scalar T1, typename T2>
+[[nodiscard]] var<T2> hypot(T1 x, var<T2> y) {
+  return details::record(y, htl::hypot(x, details::seed(y)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> hypot(const var<T>& x, const var<T>& y) {
+  return details::record(
+      x, y, htl::hypot(details::seed(x, 0), details::seed(y, 1)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> sinh(var<T> arg) {
+  return details::record(arg, htl::sinh(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> cosh(var<T> arg) {
+  return details::record(arg, htl::cosh(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> tanh(var<T> arg) {
+  return details::record(arg, htl::tanh(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> asinh(var<T> arg) {
+  return details::record(arg, htl::asinh(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> acosh(var<T> arg) {
+  return details::record(arg, htl::acosh(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> atanh(var<T> arg) {
+  return details::record(arg, htl::atanh(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> erf(var<T> arg) {
+  return details::record(arg, htl::erf(details::seed(arg)));
+}
+
+template <typename T>
+[[nodiscard]] var<T> erfc(var<T> arg) {
+  return details::record(arg, htl::erfc(details::seed(arg)));
+}
+
+// At a tie, the first argument is returned, so only it receives the adjoint.
+template <typename T>
+[[nodiscard]] var<T> min(const var<T>& a, const var<T>& b) {
+  return b.value() < a.value() ? b : a;
+}
+
+template <typename T>
+[[nodiscard]] var<T> max(const var<T>& a, const var<T>& b) {
+  return a.value() < b.value() ? b : a;
+}
+
+}  // namespace htl
+
+#endif